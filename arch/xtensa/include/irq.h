@@ -206,6 +206,20 @@ static inline void xtensa_setps(uint32_t ps)
   );
 }
 
+/* Return the current value of the CCOUNT cycle counter */
+
+static inline uint32_t xtensa_getccount(void)
+{
+  uint32_t ccount;
+
+  __asm__ __volatile__
+  (
+    "rsr %0, CCOUNT"  : "=r"(ccount)
+  );
+
+  return ccount;
+}
+
 /* Restore the value of the PS register */
 
 static inline void up_irq_restore(uint32_t ps)
@@ -41,12 +41,118 @@
  ****************************************************************************/
 
 #include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include <nuttx/fs/ioctl.h>
 
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
 
+/* Architecture-specific serial IOCTL commands */
+
+#define TIOCSFIFOCONF   _TIOC(0x00c0) /* Set UART FIFO thresholds
+                                       * arg: const struct uart_fifoconf_s * */
+#define TIOCGFIFOCONF   _TIOC(0x00c1) /* Get UART FIFO thresholds
+                                       * arg: struct uart_fifoconf_s * */
+
+/* Zero-copy access to the serial buffers.  A span describes contiguous
+ * bytes inside the driver's circular buffer;  a span stops at the end of
+ * the buffer, so a second call returns the wrapped remainder.  Spans must
+ * not be used concurrently with read() or write() on the same port.
+ */
+
+#define TIOCRXSPAN      _TIOC(0x00c2) /* Get received data in place
+                                       * arg: struct uart_span_s * */
+#define TIOCRXRELEASE   _TIOC(0x00c3) /* Consume received bytes
+                                       * arg: size_t nbytes */
+#define TIOCTXRESERVE   _TIOC(0x00c4) /* Get free transmit space in place
+                                       * arg: struct uart_span_s * */
+#define TIOCTXCOMMIT    _TIOC(0x00c5) /* Queue bytes written to the space
+                                       * arg: size_t nbytes */
+
+/* Baud rate detection.  The rate is measured on the received data and
+ * programmed once enough edges have been seen.  Characters received
+ * before that are discarded (in FIFO mode) or garbled.
+ */
+
+#define TIOCSAUTOBAUD   _TIOC(0x00c6) /* Start (non-zero) or stop (zero)
+                                       * detection.  arg: int */
+#define TIOCGAUTOBAUD   _TIOC(0x00c7) /* Get the detected rate, zero while
+                                       * detecting.  arg: uint32_t * */
+
+/* Delimiter detection.  The UART flags each occurrence of the delimiter and
+ * the driver records where it ends in the RX buffer.  TIOCRXFRAME then
+ * returns the size of the oldest complete frame (delimiter included), or
+ * zero if none is buffered;  a read() of that size returns exactly the
+ * frame.
+ */
+
+#define TIOCSPATTERN    _TIOC(0x00c8) /* Set the delimiter (count 0 disables)
+                                       * arg: const struct uart_pattern_s * */
+#define TIOCRXFRAME     _TIOC(0x00c9) /* Get the size of the next frame
+                                       * arg: size_t * */
+
+/* Traffic and error counters, also listed in /proc/uart */
+
+#define TIOCGSTATS      _TIOC(0x00ca) /* Get the port counters
+                                       * arg: struct uart_stats_s * */
+#define TIOCCSTATS      _TIOC(0x00cb) /* Clear the port counters
+                                       * arg: none */
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* UART FIFO interrupt thresholds (TIOCSFIFOCONF/TIOCGFIFOCONF) */
+
+struct uart_fifoconf_s
+{
+  uint8_t rxfull;               /* RX FIFO full threshold in bytes */
+  uint8_t rxtout;               /* RX timeout in symbol times (0=disabled) */
+  uint8_t txempty;              /* TX FIFO empty threshold in bytes */
+  bool    adaptive;             /* Adapt rxfull/rxtout to the byte rate */
+};
+
+/* Frame delimiter (TIOCSPATTERN).  The delimiter is count consecutive chr
+ * characters, no more than gaptout bit times apart, preceded and followed
+ * by at least preidle and postidle bit times of idle line.  Times are
+ * converted at the current baud rate.
+ */
+
+struct uart_pattern_s
+{
+  uint8_t  chr;                 /* Delimiter character */
+  uint8_t  count;               /* Consecutive delimiter characters */
+  uint16_t gaptout;             /* Maximum gap between them (bit times) */
+  uint16_t preidle;             /* Idle time before (bit times) */
+  uint16_t postidle;            /* Idle time after (bit times) */
+};
+
+/* Per-port counters (TIOCGSTATS).  The average number of bytes moved per
+ * interrupt is (rxbytes + txbytes) / interrupts.
+ */
+
+struct uart_stats_s
+{
+  uint32_t rxbytes;             /* Bytes stored in the RX buffer */
+  uint32_t txbytes;             /* Bytes sent from the TX buffer */
+  uint32_t interrupts;          /* UART and UHCI interrupts taken */
+  uint32_t passes;              /* Passes through the UART interrupt loop */
+  uint32_t rxoverflow;          /* RX FIFO overflows */
+  uint32_t frameerr;            /* Frame errors */
+  uint32_t parityerr;           /* Parity errors */
+  uint32_t rxdropped;           /* Bytes dropped with the RX buffer full */
+};
+
+/* A contiguous span of a serial buffer (TIOCRXSPAN/TIOCTXRESERVE) */
+
+struct uart_span_s
+{
+  char   *buffer;               /* First byte of the span */
+  size_t  nbytes;               /* Number of bytes in the span */
+};
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
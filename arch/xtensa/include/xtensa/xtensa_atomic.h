@@ -0,0 +1,388 @@
+/****************************************************************************
+ * arch/xtensa/include/xtensa/xtensa_atomic.h
+ *
+ *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __ARCH_XTENSA_INCLUDE_XTENSA_XTENSA_ATOMIC_H
+#define __ARCH_XTENSA_INCLUDE_XTENSA_XTENSA_ATOMIC_H
+
+/* Lock-free atomic operations on 32-bit values.
+ *
+ * These are built on the S32C1I compare-and-set instruction and follow the
+ * semantics of the corresponding C11 atomic_*_explicit() operations.  The
+ * memory order arguments take the same values as C11 memory_order (the
+ * GCC __ATOMIC_* constants), so objects may be shared with code using
+ * <stdatomic.h> or std::atomic, which GCC lowers to the same S32C1I
+ * sequences on this target.
+ *
+ * On the ESP32, loads and stores to the same address are not reordered,
+ * but MEMW is needed to order accesses to different addresses.  Every
+ * order other than XTENSA_ATOMIC_RELAXED therefore issues MEMW before
+ * and/or after the operation.
+ *
+ * When not built for the Xtensa (for example, to exercise code using
+ * these on a host), the operations map directly to the GCC __atomic
+ * builtins.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#ifndef __ASSEMBLY__
+#  include <stdint.h>
+#  include <stdbool.h>
+#endif
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Memory orders.  Identical to C11 memory_order. */
+
+#define XTENSA_ATOMIC_RELAXED  __ATOMIC_RELAXED
+#define XTENSA_ATOMIC_CONSUME  __ATOMIC_CONSUME
+#define XTENSA_ATOMIC_ACQUIRE  __ATOMIC_ACQUIRE
+#define XTENSA_ATOMIC_RELEASE  __ATOMIC_RELEASE
+#define XTENSA_ATOMIC_ACQ_REL  __ATOMIC_ACQ_REL
+#define XTENSA_ATOMIC_SEQ_CST  __ATOMIC_SEQ_CST
+
+#ifndef __ASSEMBLY__
+
+/****************************************************************************
+ * Inline Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: xtensa_memw
+ *
+ * Description:
+ *   Memory barrier:  All preceding loads and stores complete before any
+ *   following load or store.
+ *
+ ****************************************************************************/
+
+static inline void xtensa_memw(void)
+{
+#ifdef __XTENSA__
+  __asm__ __volatile__ ("memw" : : : "memory");
+#else
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+#ifdef __XTENSA__
+/****************************************************************************
+ * Name: xtensa_compareset
+ *
+ * Description:
+ *   Wrapper for the Xtensa compare-and-set instruction. This function will
+ *   atomically compare *addr to compare, and if it's the same, will set
+ *   *addr to set. It will return the old value of *addr.
+ *
+ *   Warning: From the ISA docs: in some (unspecified) cases, the s32c1i
+ *   instruction may return the *bitwise inverse* of the old mem if the
+ *   mem wasn't written.  So only a return value equal to 'compare' may be
+ *   trusted:  It means that the store was performed.
+ *
+ ****************************************************************************/
+
+static inline uint32_t xtensa_compareset(volatile uint32_t *addr,
+                                         uint32_t compare,
+                                         uint32_t set)
+{
+  __asm__ __volatile__
+  (
+    "WSR    %2, SCOMPARE1\n" /* Initialize SCOMPARE1 */
+    "ISYNC\n"                /* Wait sync */
+    "S32C1I %0, %1, 0\n"     /* Store id into the lock, if the lock is the
+                              * same as comparel. Otherwise, no write-access */
+    : "=r"(set) : "r"(addr), "r"(compare), "0"(set) : "memory"
+  );
+
+  return set;
+}
+
+/* MEMW as needed before and after an operation with memory order 'o' */
+
+#  define xtensa_atomic_pre(o) \
+  do { if ((o) != XTENSA_ATOMIC_RELAXED && (o) != XTENSA_ATOMIC_ACQUIRE && \
+           (o) != XTENSA_ATOMIC_CONSUME) xtensa_memw(); } while (0)
+#  define xtensa_atomic_post(o) \
+  do { if ((o) != XTENSA_ATOMIC_RELAXED && (o) != XTENSA_ATOMIC_RELEASE) \
+         xtensa_memw(); } while (0)
+
+/* Read-modify-write loop common to the fetch_<op> operations */
+
+#  define XTENSA_ATOMIC_RMW(p, newval, o) \
+  uint32_t old; \
+  xtensa_atomic_pre(o); \
+  do \
+    { \
+      old = *(p); \
+    } \
+  while (xtensa_compareset((p), old, (newval)) != old); \
+  xtensa_atomic_post(o); \
+  return old
+
+#else
+static inline uint32_t xtensa_compareset(volatile uint32_t *addr,
+                                         uint32_t compare,
+                                         uint32_t set)
+{
+  (void)__atomic_compare_exchange_n(addr, &compare, set, false,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+  return compare;
+}
+#endif
+
+/****************************************************************************
+ * Name: xtensa_atomic_thread_fence
+ *
+ * Description:
+ *   Equivalent of atomic_thread_fence().
+ *
+ ****************************************************************************/
+
+static inline void xtensa_atomic_thread_fence(int order)
+{
+  if (order != XTENSA_ATOMIC_RELAXED)
+    {
+      xtensa_memw();
+    }
+}
+
+/****************************************************************************
+ * Name: xtensa_atomic_load
+ *
+ * Description:
+ *   Equivalent of atomic_load_explicit().  Aligned 32-bit loads are atomic.
+ *
+ ****************************************************************************/
+
+static inline uint32_t xtensa_atomic_load(volatile uint32_t *ptr, int order)
+{
+#ifdef __XTENSA__
+  uint32_t value;
+
+  if (order == XTENSA_ATOMIC_SEQ_CST)
+    {
+      xtensa_memw();
+    }
+
+  value = *ptr;
+  xtensa_atomic_post(order);
+  return value;
+#else
+  return __atomic_load_n(ptr, order);
+#endif
+}
+
+/****************************************************************************
+ * Name: xtensa_atomic_store
+ *
+ * Description:
+ *   Equivalent of atomic_store_explicit().  Aligned 32-bit stores are
+ *   atomic.
+ *
+ ****************************************************************************/
+
+static inline void xtensa_atomic_store(volatile uint32_t *ptr,
+                                       uint32_t value, int order)
+{
+#ifdef __XTENSA__
+  xtensa_atomic_pre(order);
+  *ptr = value;
+  if (order == XTENSA_ATOMIC_SEQ_CST)
+    {
+      xtensa_memw();
+    }
+#else
+  __atomic_store_n(ptr, value, order);
+#endif
+}
+
+/****************************************************************************
+ * Name: xtensa_atomic_exchange
+ *
+ * Description:
+ *   Equivalent of atomic_exchange_explicit():  Store 'value' and return
+ *   the previous value.
+ *
+ ****************************************************************************/
+
+static inline uint32_t xtensa_atomic_exchange(volatile uint32_t *ptr,
+                                              uint32_t value, int order)
+{
+#ifdef __XTENSA__
+  XTENSA_ATOMIC_RMW(ptr, value, order);
+#else
+  return __atomic_exchange_n(ptr, value, order);
+#endif
+}
+
+/****************************************************************************
+ * Name: xtensa_atomic_compare_exchange_weak
+ *
+ * Description:
+ *   Equivalent of atomic_compare_exchange_weak_explicit():  If *ptr equals
+ *   *expected, store 'desired' and return true.  Otherwise load the
+ *   current value into *expected and return false.
+ *
+ *   This makes a single S32C1I attempt and may fail spuriously, so it is
+ *   meant for use in retry loops.
+ *
+ ****************************************************************************/
+
+static inline bool
+xtensa_atomic_compare_exchange_weak(volatile uint32_t *ptr,
+                                    uint32_t *expected, uint32_t desired,
+                                    int success, int failure)
+{
+#ifdef __XTENSA__
+  uint32_t compare = *expected;
+
+  xtensa_atomic_pre(success);
+  if (xtensa_compareset(ptr, compare, desired) == compare)
+    {
+      xtensa_atomic_post(success);
+      return true;
+    }
+
+  /* S32C1I may return ~SCOMPARE1 rather than the value in memory when it
+   * fails, so report a fresh load.
+   */
+
+  *expected = *ptr;
+  xtensa_atomic_post(failure);
+  return false;
+#else
+  return __atomic_compare_exchange_n(ptr, expected, desired, true,
+                                     success, failure);
+#endif
+}
+
+/****************************************************************************
+ * Name: xtensa_atomic_compare_exchange_strong
+ *
+ * Description:
+ *   Equivalent of atomic_compare_exchange_strong_explicit().  Like the
+ *   weak variant, but fails only if *ptr really differed from *expected.
+ *
+ ****************************************************************************/
+
+static inline bool
+xtensa_atomic_compare_exchange_strong(volatile uint32_t *ptr,
+                                      uint32_t *expected, uint32_t desired,
+                                      int success, int failure)
+{
+#ifdef __XTENSA__
+  uint32_t compare = *expected;
+
+  while (!xtensa_atomic_compare_exchange_weak(ptr, expected, desired,
+                                              success, failure))
+    {
+      if (*expected != compare)
+        {
+          return false;
+        }
+    }
+
+  return true;
+#else
+  return __atomic_compare_exchange_n(ptr, expected, desired, false,
+                                     success, failure);
+#endif
+}
+
+/****************************************************************************
+ * Name: xtensa_atomic_fetch_<op>
+ *
+ * Description:
+ *   Equivalents of atomic_fetch_<op>_explicit():  Atomically apply <op>
+ *   with 'value' to *ptr and return the previous value.
+ *
+ ****************************************************************************/
+
+static inline uint32_t xtensa_atomic_fetch_add(volatile uint32_t *ptr,
+                                               uint32_t value, int order)
+{
+#ifdef __XTENSA__
+  XTENSA_ATOMIC_RMW(ptr, old + value, order);
+#else
+  return __atomic_fetch_add(ptr, value, order);
+#endif
+}
+
+static inline uint32_t xtensa_atomic_fetch_sub(volatile uint32_t *ptr,
+                                               uint32_t value, int order)
+{
+#ifdef __XTENSA__
+  XTENSA_ATOMIC_RMW(ptr, old - value, order);
+#else
+  return __atomic_fetch_sub(ptr, value, order);
+#endif
+}
+
+static inline uint32_t xtensa_atomic_fetch_and(volatile uint32_t *ptr,
+                                               uint32_t value, int order)
+{
+#ifdef __XTENSA__
+  XTENSA_ATOMIC_RMW(ptr, old & value, order);
+#else
+  return __atomic_fetch_and(ptr, value, order);
+#endif
+}
+
+static inline uint32_t xtensa_atomic_fetch_or(volatile uint32_t *ptr,
+                                              uint32_t value, int order)
+{
+#ifdef __XTENSA__
+  XTENSA_ATOMIC_RMW(ptr, old | value, order);
+#else
+  return __atomic_fetch_or(ptr, value, order);
+#endif
+}
+
+static inline uint32_t xtensa_atomic_fetch_xor(volatile uint32_t *ptr,
+                                               uint32_t value, int order)
+{
+#ifdef __XTENSA__
+  XTENSA_ATOMIC_RMW(ptr, old ^ value, order);
+#else
+  return __atomic_fetch_xor(ptr, value, order);
+#endif
+}
+
+#endif /* __ASSEMBLY__ */
+#endif /* __ARCH_XTENSA_INCLUDE_XTENSA_XTENSA_ATOMIC_H */
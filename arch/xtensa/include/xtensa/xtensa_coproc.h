@@ -165,7 +165,9 @@ static inline void xtensa_set_cpenable(uint32_t cpenable)
 {
   __asm__ __volatile__
   (
-    "wsr %0, PS"  : : "r"(cpenable)
+    "wsr %0, CPENABLE\n"
+    "rsync\n"
+    : : "r"(cpenable)
   );
 }
 
@@ -0,0 +1,140 @@
+/****************************************************************************
+ * arch/xtensa/include/xtensa/xtensa_swstats.h
+ *
+ *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __ARCH_XTENSA_INCLUDE_XTENSA_XTENSA_SWSTATS_H
+#define __ARCH_XTENSA_INCLUDE_XTENSA_XTENSA_SWSTATS_H
+
+/* Context switch cycle statistics (CONFIG_XTENSA_SWITCH_STATS).
+ *
+ * Each CPU accumulates CCOUNT cycle counts for the operations listed
+ * below.  Together with a test that drives the scheduler (thread yield,
+ * semaphore ping-pong, interrupt-to-thread and cross-CPU wakeup), these
+ * separate the cost of the architecture switch paths from the cost of the
+ * scheduler itself.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#ifndef __ASSEMBLY__
+#  include <stdint.h>
+#endif
+
+#ifdef CONFIG_XTENSA_SWITCH_STATS
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Measured operations */
+
+#define XTENSA_SWSTAT_IRQ        0 /* Outermost interrupt dispatch */
+#define XTENSA_SWSTAT_IRQSWITCH  1 /* Outermost dispatch that switched threads */
+#define XTENSA_SWSTAT_COPYSTATE  2 /* Interrupt state copy into the TCB */
+#define XTENSA_SWSTAT_SYNC       3 /* Synchronous switch-out */
+#define XTENSA_SWSTAT_IRQLATENCY 4 /* Interrupt entry latency probe */
+#define XTENSA_SWSTAT_NSTATS     5
+
+/* Histogram bin n counts the samples of 2^n up to 2^(n+1)-1 cycles.  The
+ * last bin also counts all longer samples.
+ */
+
+#define XTENSA_SWSTAT_NBINS      16
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+#ifndef __ASSEMBLY__
+struct xtensa_swstat_s
+{
+  uint32_t count;                       /* Number of samples */
+  uint32_t min;                         /* Fewest cycles */
+  uint32_t max;                         /* Most cycles */
+  uint64_t total;                       /* Sum of all samples */
+  uint32_t hist[XTENSA_SWSTAT_NBINS];   /* Log2 distribution */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: xtensa_swstat_get
+ *
+ * Description:
+ *   Return a consistent copy of one statistic of one CPU.
+ *
+ * Input Parameters:
+ *   cpu    - The CPU index
+ *   stat   - One of XTENSA_SWSTAT_*
+ *   result - Location to return the statistic
+ *
+ * Returned Value:
+ *   Zero (OK) on success; -EINVAL if 'cpu' or 'stat' is out of range.
+ *
+ ****************************************************************************/
+
+int xtensa_swstat_get(int cpu, int stat, FAR struct xtensa_swstat_s *result);
+
+/****************************************************************************
+ * Name: xtensa_swstat_reset
+ *
+ * Description:
+ *   Discard all samples of all CPUs.
+ *
+ ****************************************************************************/
+
+void xtensa_swstat_reset(void);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ASSEMBLY__ */
+#endif /* CONFIG_XTENSA_SWITCH_STATS */
+#endif /* __ARCH_XTENSA_INCLUDE_XTENSA_XTENSA_SWSTATS_H */
@@ -47,6 +47,7 @@
 
 #include <arch/chip/core-isa.h>
 #include <arch/chip/tie.h>
+#include <arch/xtensa/xtensa_swstats.h>
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -119,13 +120,41 @@
  * state save area in the TCB and thus avoid the copy.
  */
 
-#define xtensa_savestate(regs)    xtensa_copystate(regs, (uint32_t*)CURRENT_REGS)
+#ifndef CONFIG_XTENSA_SWITCH_STATS
+#  define xtensa_savestate(regs)  xtensa_copystate(regs, (uint32_t*)CURRENT_REGS)
+#endif
 #define xtensa_restorestate(regs) do { CURRENT_REGS = regs; } while (0)
 
+/* Context switch cycle statistics.  xtensa_swstat_mark() starts a
+ * measurement on this CPU that xtensa_swstat_since() completes.  Both must
+ * be called with interrupts disabled.
+ */
+
+#ifdef CONFIG_XTENSA_SWITCH_STATS
+#  define xtensa_savestate(regs) \
+     do \
+       { \
+         uint32_t _start = xtensa_getccount(); \
+         xtensa_copystate(regs, (uint32_t*)CURRENT_REGS); \
+         xtensa_swstat_record(XTENSA_SWSTAT_COPYSTATE, \
+                              xtensa_getccount() - _start); \
+       } \
+     while (0)
+#  define xtensa_swstat_mark() \
+     do { xtensa_percpu()->swmark = xtensa_getccount(); } while (0)
+#  define xtensa_swstat_since(stat) \
+     xtensa_swstat_record(stat, xtensa_getccount() - xtensa_percpu()->swmark)
+#else
+#  define xtensa_swstat_mark()
+#  define xtensa_swstat_since(stat)
+#endif
+
 /* Interrupt codes from other CPUs: */
 
-#define CPU_INTCODE_NONE  0
-#define CPU_INTCODE_PAUSE 1
+#define CPU_INTCODE_NONE       0
+#define CPU_INTCODE_PAUSE      1
+#define CPU_INTCODE_IRQMIGRATE 2 /* Complete a peripheral IRQ migration */
+#define CPU_INTCODE_CALL       3 /* Run a function:  arg0 = xtensa_cpucall_s */
 
 /* Exception Codes that may be received by xtensa_panic(). */
 
@@ -153,32 +182,93 @@
  * Public Types
  ****************************************************************************/
 
+#ifndef __ASSEMBLY__
+/* Per-CPU data.  Each CPU's entry is padded and aligned to 32 bytes so
+ * that the entries of different CPUs never share an aligned block and
+ * remain separate should g_percpu ever be placed in cached memory.
+ */
+
+#define XTENSA_PERCPU_ALIGN 32
+
+struct xtensa_percpu_s
+{
+  /* current_regs holds a reference to the current interrupt level
+   * register storage structure.  It is non-NULL only during interrupt
+   * processing.
+   */
+
+  volatile uint32_t *current_regs;
+
+#ifdef CONFIG_XTENSA_NESTED_INTERRUPTS
+  /* Interrupt nesting depth.  An interrupt may only be preempted by an
+   * interrupt at a higher level so the depth is bounded by
+   * XCHAL_EXCM_LEVEL.
+   */
+
+  uint8_t irqdepth;
+#endif
+
+#ifdef CONFIG_XTENSA_LAZY_COPROC
+  /* The thread whose state is held in the co-processors, or NULL */
+
+  struct xtensa_cpstate_s *cpowner;
+#endif
+
+#ifdef CONFIG_XTENSA_SWITCH_STATS
+  /* Context switch cycle statistics.  swseq is odd while this CPU updates
+   * swstat[] and swmark is the start of the measurement in progress (see
+   * xtensa_swstat_mark()).
+   */
+
+  volatile uint32_t swseq;
+  uint32_t swmark;
+  struct xtensa_swstat_s swstat[XTENSA_SWSTAT_NSTATS];
+#endif
+} aligned_data(XTENSA_PERCPU_ALIGN);
+#endif
+
+#if defined(CONFIG_SMP) && !defined(__ASSEMBLY__)
+/* A function to be run on another CPU by xtensa_cpu_call() */
+
+typedef int (*xtensa_cpucall_t)(FAR void *arg);
+
+/* Describes one remote function call and receives its completion.  The
+ * structure belongs to the target CPU from the time that the call is
+ * queued until 'done' becomes true.
+ */
+
+struct xtensa_cpucall_s
+{
+  xtensa_cpucall_t func;            /* Function to run on the target CPU */
+  FAR void *arg;                    /* Argument passed to 'func' */
+  volatile int result;              /* Value returned by 'func' */
+  volatile bool done;               /* True when 'result' is valid */
+};
+#endif
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
 
 #ifndef __ASSEMBLY__
-/* g_current_regs[] holds a references to the current interrupt level
- * register storage structure.  If is non-NULL only during interrupt
- * processing.  Access to g_current_regs[] must be through the macro
- * CURRENT_REGS for portability.
+/* g_percpu[] holds the per-CPU data described by struct xtensa_percpu_s.
+ * When CONFIG_SMP is selected, the MISC0 special register of each CPU
+ * holds the address of that CPU's entry so that it can be reached with a
+ * single RSR rather than a call to up_cpu_index().
  */
 
 #ifdef CONFIG_SMP
-/* For the case of architectures with multiple CPUs, then there must be one
- * such value for each processor that can receive an interrupt.
- */
-
 int up_cpu_index(void); /* See include/nuttx/arch.h */
-extern volatile uint32_t *g_current_regs[CONFIG_SMP_NCPUS];
-#  define CURRENT_REGS (g_current_regs[up_cpu_index()])
-
+extern struct xtensa_percpu_s g_percpu[CONFIG_SMP_NCPUS];
 #else
+extern struct xtensa_percpu_s g_percpu[1];
+#endif
 
-extern volatile uint32_t *g_current_regs[1];
-#  define CURRENT_REGS (g_current_regs[0])
+/* The current interrupt level register storage structure.  Access must be
+ * through the macro CURRENT_REGS for portability.
+ */
 
-#endif
+#define CURRENT_REGS (xtensa_percpu()->current_regs)
 
 /* Address of the saved user stack pointer */
 
@@ -214,6 +304,51 @@ extern uint32_t _eheap;             /* End+1 of heap */
  * Inline Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: xtensa_percpu
+ *
+ * Description:
+ *   Return the per-CPU data of the current CPU.
+ *
+ ****************************************************************************/
+
+static inline FAR struct xtensa_percpu_s *xtensa_percpu(void)
+{
+#ifdef CONFIG_SMP
+  FAR struct xtensa_percpu_s *percpu;
+
+  __asm__ __volatile__
+  (
+    "rsr %0, MISC0"  : "=r"(percpu)
+  );
+
+  return percpu;
+#else
+  return &g_percpu[0];
+#endif
+}
+
+/****************************************************************************
+ * Name: xtensa_percpu_initialize
+ *
+ * Description:
+ *   Point MISC0 at the per-CPU data of 'cpu'.  This must be called on each
+ *   CPU before CURRENT_REGS is first accessed.
+ *
+ ****************************************************************************/
+
+static inline void xtensa_percpu_initialize(int cpu)
+{
+#ifdef CONFIG_SMP
+  __asm__ __volatile__
+  (
+    "wsr   %0, MISC0\n"
+    "rsync\n"
+    : : "r"(&g_percpu[cpu])
+  );
+#endif
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -266,7 +401,7 @@ void xtensa_coproc_disable(struct xtensa_cpstate_s *cpstate, int cpset);
 
 /* IRQs */
 
-uint32_t *xtensa_int_decode(uint32_t *regs);
+uint32_t *xtensa_int_decode(uint32_t cpuints, uint32_t *regs);
 uint32_t *xtensa_irq_dispatch(int irq, uint32_t *regs);
 uint32_t xtensa_enable_cpuint(uint32_t *shadow, uint32_t intmask);
 uint32_t xtensa_disable_cpuint(uint32_t *shadow, uint32_t intmask);
@@ -277,8 +412,17 @@ void xtensa_user(int exccause, uint32_t *regs) noreturn_function;
 
 #ifdef CONFIG_SMP
 void __cpu1_start(void) noreturn_function;
+int xtensa_intercpu_send(int tocpu, int intcode, uintptr_t arg0,
+                         uintptr_t arg1);
 int xtensa_intercpu_interrupt(int tocpu, int intcode);
 void xtensa_pause_handler(void);
+
+/* Remote function calls */
+
+void xtensa_cpucall_handler(FAR struct xtensa_cpucall_s *call);
+int xtensa_cpu_call_async(int cpu, FAR struct xtensa_cpucall_s *call);
+int xtensa_cpu_call_wait(FAR struct xtensa_cpucall_s *call);
+int xtensa_cpu_call(int cpu, xtensa_cpucall_t func, FAR void *arg);
 #endif
 
 /* Synchronous context switching */
@@ -289,12 +433,34 @@ void xtensa_context_restore(uint32_t *regs) noreturn_function;
 #if XCHAL_CP_NUM > 0
 void xtensa_coproc_savestate(struct xtensa_cpstate_s *cpstate);
 void xtensa_coproc_restorestate(struct xtensa_cpstate_s *cpstate);
+
+/* Co-processor state handling when a thread is switched out or in.  With
+ * CONFIG_XTENSA_LAZY_COPROC, the state is only switched when a thread
+ * actually uses a co-processor.
+ */
+
+#ifdef CONFIG_XTENSA_LAZY_COPROC
+void xtensa_coproc_switchout(struct xtensa_cpstate_s *cpstate);
+void xtensa_coproc_switchin(struct xtensa_cpstate_s *cpstate);
+void xtensa_coproc_release(struct xtensa_cpstate_s *cpstate);
+void xtensa_coproc_exception(uint32_t *regs);
+#else
+#  define xtensa_coproc_switchout(cpstate) xtensa_coproc_savestate(cpstate)
+#  define xtensa_coproc_switchin(cpstate)  xtensa_coproc_restorestate(cpstate)
+#  define xtensa_coproc_release(cpstate)
+#endif
 #endif
 
 /* Signals */
 
 void xtensa_sigdeliver(void);
 
+/* Context switch cycle statistics */
+
+#ifdef CONFIG_XTENSA_SWITCH_STATS
+void xtensa_swstat_record(int stat, uint32_t cycles);
+#endif
+
 /* Chip-specific functions **************************************************/
 /* Chip specific functions defined in arch/xtensa/src/<chip> */
 /* IRQs */
@@ -302,6 +468,9 @@ void xtensa_sigdeliver(void);
 void xtensa_irq_initialize(void);
 bool xtensa_pending_irq(int irq);
 void xtensa_clrpend_irq(int irq);
+#ifdef CONFIG_XTENSA_NESTED_INTERRUPTS
+int xtensa_irq_level(int irq);
+#endif
 
 /* DMA */
 
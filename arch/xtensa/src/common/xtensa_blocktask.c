@@ -115,6 +115,10 @@ void up_block_task(struct tcb_s *tcb, tstate_t task_state)
 
       sched_suspend_scheduler(rtcb);
 
+      /* Start timing a synchronous switch (if not in an interrupt) */
+
+      xtensa_swstat_mark();
+
       /* Are we in an interrupt handler? */
 
       if (CURRENT_REGS)
@@ -154,7 +158,7 @@ void up_block_task(struct tcb_s *tcb, tstate_t task_state)
            * processor save area.
            */
 
-          xtensa_coproc_savestate(&rtcb->xcp.cpstate);
+          xtensa_coproc_switchout(&rtcb->xcp.cpstate);
 #endif
 
           /* Restore the exception context of the rtcb at the (new) head
@@ -166,7 +170,7 @@ void up_block_task(struct tcb_s *tcb, tstate_t task_state)
 #if XCHAL_CP_NUM > 0
           /* Set up the co-processor state for the newly started thread. */
 
-          xtensa_coproc_restorestate(&rtcb->xcp.cpstate);
+          xtensa_coproc_switchin(&rtcb->xcp.cpstate);
 #endif
 
 #ifdef CONFIG_ARCH_ADDRENV
@@ -184,6 +188,7 @@ void up_block_task(struct tcb_s *tcb, tstate_t task_state)
 
           /* Then switch contexts */
 
+          xtensa_swstat_since(XTENSA_SWSTAT_SYNC);
           xtensa_context_restore(rtcb->xcp.regs);
         }
     }
@@ -73,7 +73,9 @@
 void xtensa_coproc_enable(struct xtensa_cpstate_s *cpstate, int cpset)
 {
   irqstate_t flags;
+#ifndef CONFIG_XTENSA_LAZY_COPROC
   uint32_t cpenable;
+#endif
 
   /* These operations must be atomic */
 
@@ -91,6 +93,20 @@ void xtensa_coproc_enable(struct xtensa_cpstate_s *cpstate, int cpset)
   cpset ^= (cpset & cpstate->cpenable);
   if (cpset != 0)
     {
+#ifdef CONFIG_XTENSA_LAZY_COPROC
+      /* CPENABLE only reflects the thread's co-processors while the thread
+       * owns the co-processor state.  Otherwise, CPENABLE is set on first
+       * use.
+       */
+
+      cpstate->cpenable |= cpset;
+      cpstate->cpstored &= ~cpset;
+
+      if (xtensa_percpu()->cpowner == cpstate)
+        {
+          xtensa_set_cpenable(cpstate->cpenable);
+        }
+#else
       /* Enable the co-processors */
 
       cpenable = xtensa_get_cpenable();
@@ -99,6 +115,7 @@ void xtensa_coproc_enable(struct xtensa_cpstate_s *cpstate, int cpset)
 
       cpstate->cpenable  = cpenable;
       cpstate->cpstored &= ~cpset;
+#endif
     }
 
   leave_critical_section(flags);
@@ -124,7 +141,9 @@ void xtensa_coproc_enable(struct xtensa_cpstate_s *cpstate, int cpset)
 void xtensa_coproc_disable(struct xtensa_cpstate_s *cpstate, int cpset)
 {
   irqstate_t flags;
+#ifndef CONFIG_XTENSA_LAZY_COPROC
   uint32_t cpenable;
+#endif
 
   /* These operations must be atomic */
 
@@ -142,6 +161,17 @@ void xtensa_coproc_disable(struct xtensa_cpstate_s *cpstate, int cpset)
   cpset &= cpstate->cpenable;
   if (cpset != 0)
     {
+#ifdef CONFIG_XTENSA_LAZY_COPROC
+      /* See xtensa_coproc_enable() */
+
+      cpstate->cpenable &= ~cpset;
+      cpstate->cpstored &= ~cpset;
+
+      if (xtensa_percpu()->cpowner == cpstate)
+        {
+          xtensa_set_cpenable(cpstate->cpenable);
+        }
+#else
       /* Disable the co-processors */
 
       cpenable = xtensa_get_cpenable();
@@ -150,6 +180,7 @@ void xtensa_coproc_disable(struct xtensa_cpstate_s *cpstate, int cpset)
 
       cpstate->cpenable  = cpenable;
       cpstate->cpstored &= ~cpset;
+#endif
     }
 
   leave_critical_section(flags);
@@ -0,0 +1,226 @@
+/****************************************************************************
+ * arch/xtensa/src/common/xtensa_cpswitch.c
+ *
+ *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+
+#include <nuttx/arch.h>
+#include <nuttx/sched.h>
+
+#include <arch/irq.h>
+#include <arch/xtensa/xtensa_coproc.h>
+#include <arch/xtensa/xtensa_corebits.h>
+#include <arch/chip/core-isa.h>
+
+#include "sched/sched.h"
+#include "xtensa.h"
+
+#if XCHAL_CP_NUM > 0 && defined(CONFIG_XTENSA_LAZY_COPROC)
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifdef CONFIG_SMP
+#  define NCPUS CONFIG_SMP_NCPUS
+#else
+#  define NCPUS 1
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: xtensa_coproc_switchout
+ *
+ * Description:
+ *   Called when the thread owning 'cpstate' is switched out.  Nothing need
+ *   be done unless the thread owns the co-processor state of this CPU:
+ *
+ *   - With a single CPU, the state simply stays in the co-processors until
+ *     some other thread needs them or until the owner runs again.
+ *   - With SMP, the state is saved now because the thread may next run on
+ *     the other CPU.  Only threads that used a co-processor since they
+ *     last ran can be the owner so this cost is not paid by others.
+ *
+ * Assumptions:
+ *   Called with interrupts disabled.  CPENABLE still belongs to the thread
+ *   being switched out.
+ *
+ ****************************************************************************/
+
+void xtensa_coproc_switchout(struct xtensa_cpstate_s *cpstate)
+{
+#ifdef CONFIG_SMP
+  FAR struct xtensa_percpu_s *percpu = xtensa_percpu();
+
+  if (percpu->cpowner == cpstate)
+    {
+      xtensa_coproc_savestate(cpstate);
+      percpu->cpowner = NULL;
+    }
+#endif
+}
+
+/****************************************************************************
+ * Name: xtensa_coproc_switchin
+ *
+ * Description:
+ *   Called when the thread owning 'cpstate' is switched in.  If its state
+ *   is still held in the co-processors, they are simply re-enabled.
+ *   Otherwise they are disabled so that the first co-processor instruction
+ *   traps to xtensa_coproc_exception().
+ *
+ * Assumptions:
+ *   Called with interrupts disabled.
+ *
+ ****************************************************************************/
+
+void xtensa_coproc_switchin(struct xtensa_cpstate_s *cpstate)
+{
+  if (xtensa_percpu()->cpowner == cpstate)
+    {
+      xtensa_set_cpenable(cpstate->cpenable);
+    }
+  else
+    {
+      xtensa_set_cpenable(0);
+    }
+}
+
+/****************************************************************************
+ * Name: xtensa_coproc_release
+ *
+ * Description:
+ *   The thread owning 'cpstate' is being destroyed.  Forget that it owns
+ *   any co-processor state so that the state is not later saved into
+ *   memory that has been freed.
+ *
+ ****************************************************************************/
+
+void xtensa_coproc_release(struct xtensa_cpstate_s *cpstate)
+{
+  irqstate_t flags;
+  int cpu;
+
+  flags = up_irq_save();
+  for (cpu = 0; cpu < NCPUS; cpu++)
+    {
+      if (g_percpu[cpu].cpowner == cpstate)
+        {
+          g_percpu[cpu].cpowner = NULL;
+        }
+    }
+
+  up_irq_restore(flags);
+}
+
+/****************************************************************************
+ * Name: xtensa_coproc_exception
+ *
+ * Description:
+ *   Handle a Coprocessor[n]Disabled exception.  Called from
+ *   _xtensa_coproc_handler with the register state of the thread that
+ *   executed the co-processor instruction.  The state of the current
+ *   co-processor owner, if any, is saved and the state of the current
+ *   thread is restored.  The instruction is then re-executed with the
+ *   co-processor enabled.
+ *
+ *   Co-processors may not be used in interrupt handlers.  That, or an
+ *   exception for a co-processor that does not exist, is fatal.
+ *
+ * Input Parameters:
+ *   regs - The register save area.  REG_EXCCAUSE holds the exception
+ *          cause.
+ *
+ * Assumptions:
+ *   Called with low- and medium-priority interrupts disabled.
+ *
+ ****************************************************************************/
+
+void xtensa_coproc_exception(uint32_t *regs)
+{
+  FAR struct xtensa_percpu_s *percpu;
+  FAR struct xtensa_cpstate_s *cpstate;
+  FAR struct xtensa_cpstate_s *owner;
+  uint32_t exccause = regs[REG_EXCCAUSE];
+  uint32_t cpset;
+
+  cpset = 1ul << (exccause - EXCCAUSE_CP0_DISABLED);
+  if (up_interrupt_context() || (cpset & XTENSA_CP_ALLSET) == 0)
+    {
+      xtensa_user(exccause, regs);
+    }
+
+  percpu  = xtensa_percpu();
+  cpstate = &this_task()->xcp.cpstate;
+  owner   = percpu->cpowner;
+
+  if (owner != cpstate)
+    {
+      /* Save the state of the previous owner (only in the co-processors
+       * that it enabled) in its save area.
+       */
+
+      if (owner != NULL)
+        {
+          xtensa_set_cpenable(owner->cpenable);
+          xtensa_coproc_savestate(owner);
+        }
+
+      /* Restore the state that this thread saved earlier, if any, and
+       * enable its co-processors.
+       */
+
+      cpstate->cpenable |= cpset;
+      xtensa_coproc_restorestate(cpstate);
+      percpu->cpowner = cpstate;
+    }
+  else
+    {
+      /* We already own the co-processors but had not yet enabled this one */
+
+      cpstate->cpenable |= cpset;
+      xtensa_set_cpenable(cpstate->cpenable);
+    }
+}
+
+#endif /* XCHAL_CP_NUM > 0 && CONFIG_XTENSA_LAZY_COPROC */
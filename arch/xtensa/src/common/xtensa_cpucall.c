@@ -0,0 +1,212 @@
+/****************************************************************************
+ * arch/xtensa/src/common/xtensa_cpucall.c
+ *
+ *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <nuttx/arch.h>
+#include <arch/irq.h>
+
+#include "xtensa.h"
+
+#ifdef CONFIG_SMP
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: xtensa_cpucall_handler
+ *
+ * Description:
+ *   This is the handler for the CPU_INTCODE_CALL CPU interrupt.  It runs
+ *   the requested function on this CPU and then posts the completion.  The
+ *   caller may reuse or free the call structure as soon as 'done' is set,
+ *   so it must not be accessed after that.
+ *
+ * Input Parameters:
+ *   call - The remote call to be performed
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void xtensa_cpucall_handler(FAR struct xtensa_cpucall_s *call)
+{
+  DEBUGASSERT(call != NULL && call->func != NULL);
+
+  call->result = call->func(call->arg);
+
+  /* The result must be visible to the other CPU before the completion */
+
+  __sync_synchronize();
+  call->done = true;
+}
+
+/****************************************************************************
+ * Name: xtensa_cpu_call_async
+ *
+ * Description:
+ *   Run call->func(call->arg) on the selected CPU in interrupt context and
+ *   return without waiting for it.  Completion is reported through
+ *   call->done and call->result; see xtensa_cpu_call_wait().  The call
+ *   structure must remain valid until the call has completed.
+ *
+ *   If 'cpu' is the calling CPU, the function is run immediately with
+ *   interrupts disabled.
+ *
+ * Input Parameters:
+ *   cpu  - The index of the CPU that will run the function
+ *   call - Describes the function to run.  'func' and 'arg' must be set by
+ *          the caller.
+ *
+ * Returned Value:
+ *   Zero on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int xtensa_cpu_call_async(int cpu, FAR struct xtensa_cpucall_s *call)
+{
+  irqstate_t flags;
+  int ret = OK;
+
+  DEBUGASSERT(cpu >= 0 && cpu < CONFIG_SMP_NCPUS);
+  DEBUGASSERT(call != NULL && call->func != NULL);
+
+  call->done = false;
+
+  /* Disable interrupts so that we cannot migrate to 'cpu' between the
+   * test and the request.
+   */
+
+  flags = up_irq_save();
+  if (cpu == up_cpu_index())
+    {
+      xtensa_cpucall_handler(call);
+    }
+  else
+    {
+      ret = xtensa_intercpu_send(cpu, CPU_INTCODE_CALL, (uintptr_t)call, 0);
+    }
+
+  up_irq_restore(flags);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: xtensa_cpu_call_wait
+ *
+ * Description:
+ *   Wait for a call started by xtensa_cpu_call_async() to complete.
+ *
+ *   This busy waits.  It must not be called from an interrupt handler or
+ *   with interrupts disabled:  The target CPU might be waiting for this CPU
+ *   in the same way and neither would then ever complete.
+ *
+ * Input Parameters:
+ *   call - The call started by xtensa_cpu_call_async()
+ *
+ * Returned Value:
+ *   The value returned by the remote function.
+ *
+ ****************************************************************************/
+
+int xtensa_cpu_call_wait(FAR struct xtensa_cpucall_s *call)
+{
+  DEBUGASSERT(call != NULL);
+
+  while (!call->done)
+    {
+    }
+
+  /* Do not read the result before the completion */
+
+  __sync_synchronize();
+  return call->result;
+}
+
+/****************************************************************************
+ * Name: xtensa_cpu_call
+ *
+ * Description:
+ *   Run func(arg) on the selected CPU in interrupt context and wait for it
+ *   to complete.  Unlike up_cpu_pause(), the target CPU is interrupted only
+ *   for as long as 'func' runs.
+ *
+ *   'func' runs with interrupts at the level of the inter-CPU interrupt.
+ *   It must not block and must not wait for anything held by the calling
+ *   CPU.  See also xtensa_cpu_call_wait() for the restrictions on the
+ *   caller.
+ *
+ * Input Parameters:
+ *   cpu  - The index of the CPU that will run the function
+ *   func - The function to run
+ *   arg  - The argument passed to 'func'
+ *
+ * Returned Value:
+ *   The value returned by 'func' or a negated errno value if the call
+ *   could not be made.
+ *
+ ****************************************************************************/
+
+int xtensa_cpu_call(int cpu, xtensa_cpucall_t func, FAR void *arg)
+{
+  struct xtensa_cpucall_s call;
+  int ret;
+
+  DEBUGASSERT(!up_interrupt_context());
+
+  call.func = func;
+  call.arg  = arg;
+
+  ret = xtensa_cpu_call_async(cpu, &call);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  return xtensa_cpu_call_wait(&call);
+}
+
+#endif /* CONFIG_SMP */
@@ -160,6 +160,7 @@ void _exit(int status)
 
   tcb = this_task();
   xtensa_coproc_disable(&tcb->xcp.cpstate, XTENSA_CP_ALLSET);
+  xtensa_coproc_release(&tcb->xcp.cpstate);
 #endif
 
   /* Destroy the task at the head of the ready to run list. */
@@ -175,7 +176,7 @@ void _exit(int status)
 #if XCHAL_CP_NUM > 0
   /* Set up the co-processor state for the newly started thread. */
 
-  xtensa_coproc_restorestate(&tcb->xcp.cpstate);
+  xtensa_coproc_switchin(&tcb->xcp.cpstate);
 #endif
 
 #ifdef CONFIG_ARCH_ADDRENV
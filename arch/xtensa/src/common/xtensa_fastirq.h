@@ -0,0 +1,294 @@
+/****************************************************************************
+ * arch/xtensa/src/common/xtensa_fastirq.h
+ *
+ *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __ARCH_XTENSA_SRC_COMMON_XTENSA_FASTIRQ_H
+#define __ARCH_XTENSA_SRC_COMMON_XTENSA_FASTIRQ_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <arch/chip/core-isa.h>
+
+#ifndef __ASSEMBLY__
+#  include <stdint.h>
+#endif
+
+#ifdef CONFIG_XTENSA_FASTIRQ
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Fast interrupt handlers may be attached to the high priority interrupt
+ * levels, i.e., those above XCHAL_EXCM_LEVEL.  There is one fast interrupt
+ * handler per level and per CPU.
+ */
+
+#define XTENSA_FASTIRQ_MINLEVEL   (XCHAL_EXCM_LEVEL + 1)
+#define XTENSA_FASTIRQ_NLEVELS    (XCHAL_INT_NLEVELS - XCHAL_EXCM_LEVEL)
+#define XTENSA_FASTIRQ_QSIZE      CONFIG_XTENSA_FASTIRQ_QSIZE
+
+#if (XTENSA_FASTIRQ_QSIZE & (XTENSA_FASTIRQ_QSIZE - 1)) != 0
+#  error CONFIG_XTENSA_FASTIRQ_QSIZE must be a power of two
+#endif
+
+/* Offsets into struct xtensa_fastirq_s used by the assembly language
+ * logic.  These must be kept in sync with the structure definition.
+ */
+
+#define XTENSA_FASTIRQ_HANDLER    0  /* Fast interrupt handler */
+#define XTENSA_FASTIRQ_ARG        4  /* Handler/worker argument */
+#define XTENSA_FASTIRQ_INTMASK    8  /* CPU interrupt bit */
+#define XTENSA_FASTIRQ_KICK       12 /* Register that requests the worker */
+#define XTENSA_FASTIRQ_HEAD       16 /* Number of entries queued */
+#define XTENSA_FASTIRQ_TAIL       20 /* Number of entries consumed */
+#define XTENSA_FASTIRQ_DROPPED    24 /* Number of entries lost */
+#define XTENSA_FASTIRQ_WORKER     28 /* Worker draining the queue */
+#define XTENSA_FASTIRQ_SAVE       32 /* Save area for a2-a5 */
+#define XTENSA_FASTIRQ_QUEUE      48 /* Queued work */
+#define XTENSA_FASTIRQ_SIZE       (XTENSA_FASTIRQ_QUEUE + 4 * XTENSA_FASTIRQ_QSIZE)
+
+/* Offset of the state of one CPU and level in g_fastirq[][] */
+
+#define XTENSA_FASTIRQ_OFFSET(cpu, level) \
+  (((cpu) * XTENSA_FASTIRQ_NLEVELS + (level) - XTENSA_FASTIRQ_MINLEVEL) * \
+   XTENSA_FASTIRQ_SIZE)
+
+/****************************************************************************
+ * Assembly Language Macros
+ ****************************************************************************/
+
+#ifdef __ASSEMBLY__
+
+/****************************************************************************
+ * Macro fastirq_getarea areg level
+ *
+ * Description:
+ *   Return the address of the fast interrupt state of this CPU for 'level'
+ *   in 'areg'.  Only 'areg' is modified.
+ *
+ ****************************************************************************/
+
+	.macro	fastirq_getarea	areg level
+#ifdef CONFIG_SMP
+	getcoreid	\areg
+	beqz		\areg, 3f
+	movi		\areg, g_fastirq + XTENSA_FASTIRQ_OFFSET(1, \level)
+	j			4f
+3:
+#endif
+	movi		\areg, g_fastirq + XTENSA_FASTIRQ_OFFSET(0, \level)
+4:
+	.endm
+
+/****************************************************************************
+ * Macro fastirq_dispatch level
+ *
+ * Description:
+ *   Body of the handler of a high priority interrupt level.  Only a2-a5
+ *   are saved, in a static per-CPU area (a0 was saved in EXCSAVE_<level>
+ *   by the vector).  The stack of the interrupted code is not touched.
+ *
+ *   The fast interrupt handler is then called with CALLX0 and:
+ *
+ *   a0 - Return address.  The handler returns with 'ret'.
+ *   a2 - Address of its struct xtensa_fastirq_s.  The handler argument is
+ *        at offset XTENSA_FASTIRQ_ARG.
+ *
+ *   The handler may modify a0 and a2-a5 only, must not use the stack, must
+ *   reside in IRAM and cannot call any OS or C function.  It must clear
+ *   the interrupt at its peripheral source.  Work may be passed to the
+ *   worker with fastirq_post.
+ *
+ ****************************************************************************/
+
+	.macro	fastirq_dispatch level
+
+	fastirq_getarea	a0 \level
+
+	s32i	a2, a0, XTENSA_FASTIRQ_SAVE + 0		/* Save a2-a5 */
+	s32i	a3, a0, XTENSA_FASTIRQ_SAVE + 4
+	s32i	a4, a0, XTENSA_FASTIRQ_SAVE + 8
+	s32i	a5, a0, XTENSA_FASTIRQ_SAVE + 12
+
+	l32i	a3, a0, XTENSA_FASTIRQ_INTMASK
+	l32i	a4, a0, XTENSA_FASTIRQ_HANDLER
+	wsr		a3, INTCLEAR				/* Clear edge-triggered interrupt */
+	mov		a2, a0						/* Argument: Fast interrupt state */
+	callx0	a4							/* Call the fast interrupt handler */
+
+	fastirq_getarea	a0 \level
+
+	l32i	a2, a0, XTENSA_FASTIRQ_SAVE + 0		/* Restore a2-a5 */
+	l32i	a3, a0, XTENSA_FASTIRQ_SAVE + 4
+	l32i	a4, a0, XTENSA_FASTIRQ_SAVE + 8
+	l32i	a5, a0, XTENSA_FASTIRQ_SAVE + 12
+
+	rsr		a0, EXCSAVE + \level		/* Restore a0 */
+	rfi		\level
+
+	.endm
+
+/****************************************************************************
+ * Macro fastirq_post afirq aval at0 at1
+ *
+ * Description:
+ *   Queue the word in 'aval' for the worker of the fast interrupt whose
+ *   state is at 'afirq' and request the worker interrupt.  The word is
+ *   dropped (and counted) if the queue is full.  'at0' and 'at1' are
+ *   scratch registers.  All four registers must be different.
+ *
+ ****************************************************************************/
+
+	.macro	fastirq_post afirq aval at0 at1
+
+	l32i	\at0, \afirq, XTENSA_FASTIRQ_HEAD
+	l32i	\at1, \afirq, XTENSA_FASTIRQ_TAIL
+	sub		\at1, \at0, \at1			/* at1 = Number of queued entries */
+	bgeui	\at1, XTENSA_FASTIRQ_QSIZE, 3f
+
+	movi	\at1, XTENSA_FASTIRQ_QSIZE - 1
+	and		\at1, \at0, \at1
+	addx4	\at1, \at1, \afirq
+	s32i	\aval, \at1, XTENSA_FASTIRQ_QUEUE
+	addi	\at0, \at0, 1
+	memw								/* Entry written before head */
+	s32i	\at0, \afirq, XTENSA_FASTIRQ_HEAD
+
+	l32i	\at0, \afirq, XTENSA_FASTIRQ_KICK
+	movi	\at1, 1
+	memw
+	s32i	\at1, \at0, 0				/* Request the worker interrupt */
+	j		4f
+
+3:
+	l32i	\at0, \afirq, XTENSA_FASTIRQ_DROPPED
+	addi	\at0, \at0, 1
+	s32i	\at0, \afirq, XTENSA_FASTIRQ_DROPPED
+4:
+	.endm
+
+#endif /* __ASSEMBLY__ */
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+#ifndef __ASSEMBLY__
+
+/* A fast interrupt handler.  This is an assembly language function with
+ * the calling conventions described for fastirq_dispatch.
+ */
+
+typedef CODE void (*xtensa_fasthandler_t)(void);
+
+/* A worker receives each word queued by the fast interrupt handler.  It
+ * runs at normal interrupt priority and may use the OS interrupt level
+ * interfaces.
+ */
+
+typedef CODE void (*xtensa_fastwork_t)(FAR void *arg, uint32_t value);
+
+/* State of the fast interrupt handler of one level on one CPU.  The queue
+ * has a single producer, the fast interrupt handler, and a single
+ * consumer, the worker.  'head' and 'tail' are free-running counters.
+ */
+
+struct xtensa_fastirq_s
+{
+  xtensa_fasthandler_t handler;   /* Fast interrupt handler */
+  FAR void *arg;                  /* Handler/worker argument */
+  uint32_t intmask;               /* CPU interrupt bit */
+  uintptr_t kick;                 /* Register that requests the worker */
+  volatile uint32_t head;         /* Number of entries queued */
+  volatile uint32_t tail;         /* Number of entries consumed */
+  volatile uint32_t dropped;      /* Number of entries lost */
+  xtensa_fastwork_t worker;       /* Worker draining the queue */
+  uint32_t save[4];               /* Save area for a2-a5 */
+  uint32_t queue[XTENSA_FASTIRQ_QSIZE];
+};
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+/* The fast interrupt state of each CPU, indexed by the CPU index and
+ * by the interrupt level minus XTENSA_FASTIRQ_MINLEVEL.  Provided by the
+ * chip logic.
+ */
+
+#ifdef CONFIG_SMP
+extern struct xtensa_fastirq_s
+  g_fastirq[CONFIG_SMP_NCPUS][XTENSA_FASTIRQ_NLEVELS];
+#else
+extern struct xtensa_fastirq_s g_fastirq[1][XTENSA_FASTIRQ_NLEVELS];
+#endif
+
+/****************************************************************************
+ * Inline Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: xtensa_fastirq_drain
+ *
+ * Description:
+ *   Pass each word queued by a fast interrupt handler to its worker.
+ *
+ ****************************************************************************/
+
+static inline void xtensa_fastirq_drain(FAR struct xtensa_fastirq_s *firq)
+{
+  uint32_t tail = firq->tail;
+  uint32_t value;
+
+  while (tail != firq->head)
+    {
+      value = firq->queue[tail & (XTENSA_FASTIRQ_QSIZE - 1)];
+
+      /* Release the entry before calling the worker so that the handler
+       * may reuse it as soon as possible.
+       */
+
+      firq->tail = ++tail;
+      firq->worker(firq->arg, value);
+    }
+}
+
+#endif /* __ASSEMBLY__ */
+#endif /* CONFIG_XTENSA_FASTIRQ */
+#endif /* __ARCH_XTENSA_SRC_COMMON_XTENSA_FASTIRQ_H */
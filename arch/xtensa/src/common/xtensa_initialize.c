@@ -120,7 +120,7 @@ void up_initialize(void)
 
   for (i = 0; i < CONFIG_SMP_NCPUS; i++)
     {
-      g_current_regs[i] = NULL;
+      g_percpu[i].current_regs = NULL;
     }
 #else
   CURRENT_REGS = NULL;
@@ -1,5 +1,5 @@
 /****************************************************************************
- * arch/xtensa/src/common/xtena_irqdispatch.c
+ * arch/xtensa/src/common/xtensa_irqdispatch.c
  *
  *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <gnutt@nuttx.org>
@@ -53,6 +53,39 @@
 #include "group/group.h"
 #include "sched/sched.h"
 
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: xtensa_deliver_irq
+ *
+ * Description:
+ *   Deliver the IRQ to the attached handler.  If nested interrupts are
+ *   enabled, interrupts at levels above that of the IRQ are unmasked for
+ *   the duration of the handler.  All low- and medium-priority interrupts
+ *   are masked again on return.
+ *
+ ****************************************************************************/
+
+static inline void xtensa_deliver_irq(int irq, uint32_t *regs)
+{
+#ifdef CONFIG_XTENSA_NESTED_INTERRUPTS
+  uint32_t ps = xtensa_getps();
+  int level   = xtensa_irq_level(irq);
+
+  if (level < (int)(ps & PS_INTLEVEL_MASK))
+    {
+      xtensa_setps((ps & ~PS_INTLEVEL_MASK) | PS_INTLEVEL(level));
+      irq_dispatch(irq, regs);
+      (void)up_irq_save();
+      return;
+    }
+#endif
+
+  irq_dispatch(irq, regs);
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -64,17 +97,52 @@ uint32_t *xtensa_irq_dispatch(int irq, uint32_t *regs)
   PANIC();
 
 #else
+#ifdef CONFIG_XTENSA_NESTED_INTERRUPTS
+  FAR uint8_t *depth;
+#endif
 #if XCHAL_CP_NUM > 0
-  /* Save the TCB of in case we need to save co-processor state */
-
-  struct tcb_s *tcb = this_task();
+  struct tcb_s *tcb;
+#endif
+#ifdef CONFIG_XTENSA_SWITCH_STATS
+  uint32_t start = xtensa_getccount();
 #endif
 
-  board_autoled_on(LED_INIRQ);
+#ifdef CONFIG_XTENSA_NESTED_INTERRUPTS
+  /* All low- and medium-priority interrupts are still masked here so the
+   * nesting depth of this CPU may be updated safely.
+   */
+
+  depth = &xtensa_percpu()->irqdepth;
 
+  DEBUGASSERT(*depth < XCHAL_EXCM_LEVEL);
+  if ((*depth)++ > 0)
+    {
+      /* This interrupt preempted another interrupt handler.  CURRENT_REGS
+       * still refers to the register save area of the interrupted thread
+       * so any context switch performed here applies to that thread.  The
+       * switch itself is deferred until the outermost interrupt handler
+       * returns:  Return to the preempted handler unchanged.
+       */
+
+      DEBUGASSERT(CURRENT_REGS != NULL);
+
+      xtensa_deliver_irq(irq, regs);
+      (*depth)--;
+      return regs;
+    }
+#else
   /* Nested interrupts are not supported */
 
   DEBUGASSERT(CURRENT_REGS == NULL);
+#endif
+
+#if XCHAL_CP_NUM > 0
+  /* Save the TCB of in case we need to save co-processor state */
+
+  tcb = this_task();
+#endif
+
+  board_autoled_on(LED_INIRQ);
 
   /* Current regs non-zero indicates that we are processing an interrupt;
    * CURRENT_REGS is also used to manage interrupt level context switches.
@@ -89,11 +157,12 @@ uint32_t *xtensa_irq_dispatch(int irq, uint32_t *regs)
    * operations.  This includes use of the FPU.
    */
 
-  irq_dispatch(irq, regs);
+  xtensa_deliver_irq(irq, regs);
 
 #if XCHAL_CP_NUM > 0 || defined(CONFIG_ARCH_ADDRENV)
   /* Check for a context switch.  If a context switch occurred, then
-   * CURRENT_REGS will have a different value than it did on entry.
+   * CURRENT_REGS will have a different value than it did on entry.  This
+   * includes context switches requested by nested interrupts.
    */
 
   if (regs != CURRENT_REGS)
@@ -108,7 +177,7 @@ uint32_t *xtensa_irq_dispatch(int irq, uint32_t *regs)
        * NOTE 2. We saved a reference  TCB of the original thread on entry.
        */
 
-       xtensa_coproc_savestate(&tcb->xcp.cpstate);
+       xtensa_coproc_switchout(&tcb->xcp.cpstate);
 
        /* Then set up the co-processor state for the to-be-started thread.
         *
@@ -117,7 +186,7 @@ uint32_t *xtensa_irq_dispatch(int irq, uint32_t *regs)
         */
 
        tcb = this_task();
-       xtensa_coproc_restorestate(&tcb->xcp.cpstate);
+       xtensa_coproc_switchin(&tcb->xcp.cpstate);
 #endif
 
 #ifdef CONFIG_ARCH_ADDRENV
@@ -136,8 +205,24 @@ uint32_t *xtensa_irq_dispatch(int irq, uint32_t *regs)
    * interrupt handler.
    */
 
+#ifdef CONFIG_XTENSA_SWITCH_STATS
+  if (regs != CURRENT_REGS)
+    {
+      xtensa_swstat_record(XTENSA_SWSTAT_IRQSWITCH,
+                           xtensa_getccount() - start);
+    }
+  else
+    {
+      xtensa_swstat_record(XTENSA_SWSTAT_IRQ, xtensa_getccount() - start);
+    }
+#endif
+
   regs         = (uint32_t *)CURRENT_REGS;
   CURRENT_REGS = NULL;
+
+#ifdef CONFIG_XTENSA_NESTED_INTERRUPTS
+  (*depth)--;
+#endif
 #endif
 
   board_autoled_off(LED_INIRQ);
@@ -84,6 +84,10 @@ void up_release_pending(void)
 
       sched_suspend_scheduler(rtcb);
 
+      /* Start timing a synchronous switch (if not in an interrupt) */
+
+      xtensa_swstat_mark();
+
       /* Are we operating in interrupt context? */
 
       if (CURRENT_REGS)
@@ -124,7 +128,7 @@ void up_release_pending(void)
            * processor save area.
            */
 
-          xtensa_coproc_savestate(&rtcb->xcp.cpstate);
+          xtensa_coproc_switchout(&rtcb->xcp.cpstate);
 #endif
           /* Restore the exception context of the rtcb at the (new) head
            * of the ready-to-run task list.
@@ -135,7 +139,7 @@ void up_release_pending(void)
 #if XCHAL_CP_NUM > 0
           /* Set up the co-processor state for the newly started thread. */
 
-          xtensa_coproc_restorestate(&rtcb->xcp.cpstate);
+          xtensa_coproc_switchin(&rtcb->xcp.cpstate);
 #endif
 
 #ifdef CONFIG_ARCH_ADDRENV
@@ -153,6 +157,7 @@ void up_release_pending(void)
 
           /* Then switch contexts */
 
+          xtensa_swstat_since(XTENSA_SWSTAT_SYNC);
           xtensa_context_restore(rtcb->xcp.regs);
         }
     }
@@ -84,6 +84,14 @@
 
 void up_release_stack(FAR struct tcb_s *dtcb, uint8_t ttype)
 {
+#if XCHAL_CP_NUM > 0
+  /* The co-processor save area is part of the stack allocation.  Make sure
+   * that it is no longer referenced as the co-processor owner.
+   */
+
+  xtensa_coproc_release(&dtcb->xcp.cpstate);
+#endif
+
   /* Is there a stack allocated? */
 
   if (dtcb->stack_alloc_ptr)
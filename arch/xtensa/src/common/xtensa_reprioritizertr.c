@@ -138,6 +138,10 @@ void up_reprioritize_rtr(struct tcb_s *tcb, uint8_t priority)
 
           sched_suspend_scheduler(rtcb);
 
+          /* Start timing a synchronous switch (if not in an interrupt) */
+
+          xtensa_swstat_mark();
+
           /* Are we in an interrupt handler? */
 
           if (CURRENT_REGS)
@@ -177,7 +181,7 @@ void up_reprioritize_rtr(struct tcb_s *tcb, uint8_t priority)
                * processor save area.
                */
 
-              xtensa_coproc_savestate(&rtcb->xcp.cpstate);
+              xtensa_coproc_switchout(&rtcb->xcp.cpstate);
 #endif
               /* Restore the exception context of the rtcb at the (new) head
                * of the ready-to-run task list.
@@ -188,7 +192,7 @@ void up_reprioritize_rtr(struct tcb_s *tcb, uint8_t priority)
 #if XCHAL_CP_NUM > 0
               /* Set up the co-processor state for the newly started thread. */
 
-              xtensa_coproc_restorestate(&rtcb->xcp.cpstate);
+              xtensa_coproc_switchin(&rtcb->xcp.cpstate);
 #endif
 
 #ifdef CONFIG_ARCH_ADDRENV
@@ -206,6 +210,7 @@ void up_reprioritize_rtr(struct tcb_s *tcb, uint8_t priority)
 
               /* Then switch contexts */
 
+              xtensa_swstat_since(XTENSA_SWSTAT_SYNC);
               xtensa_context_restore(rtcb->xcp.regs);
             }
         }
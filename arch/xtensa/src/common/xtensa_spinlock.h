@@ -0,0 +1,422 @@
+/****************************************************************************
+ * arch/xtensa/src/common/xtensa_spinlock.h
+ *
+ *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __ARCH_XTENSA_SRC_COMMON_XTENSA_SPINLOCK_H
+#define __ARCH_XTENSA_SRC_COMMON_XTENSA_SPINLOCK_H
+
+/* Fair and reader-writer spinlocks for the Xtensa SMP port.
+ *
+ * spinlock_t and up_testset() provide only an unfair test-and-set lock:
+ * Under contention the CPU that last released the lock tends to get it
+ * again.  The locks here are built on the same S32C1I compare-and-set and
+ * add:
+ *
+ *   - Ticket locks:  Waiters are served strictly in arrival order.
+ *   - MCS locks:  Also FIFO, but each waiter spins on its own queue node
+ *     rather than on the shared lock word.
+ *   - Reader-writer locks:  Any number of readers or one writer.  Waiting
+ *     writers block new readers so that writers are not starved.
+ *
+ * Waiters back off exponentially (ticket locks in proportion to their
+ * position in the queue) to reduce traffic on the shared lock word.
+ *
+ * None of these disable interrupts.  As with spin_lock(), the caller must
+ * do that if the lock may also be taken from an interrupt handler.
+ *
+ * Everything is inline and built on <arch/xtensa/xtensa_atomic.h>, which
+ * maps to the GCC builtins off target, so that the algorithms may also be
+ * built and exercised on a host.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <arch/xtensa/xtensa_atomic.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Backoff limits, in iterations of the delay loop */
+
+#define XTENSA_SPIN_BACKOFF_MIN   4
+#define XTENSA_SPIN_BACKOFF_MAX   1024
+
+/* Reader-writer lock word:  Reader count and writer flags */
+
+#define XTENSA_RWLOCK_WRITER      0x80000000  /* A writer holds the lock */
+#define XTENSA_RWLOCK_WAITING     0x40000000  /* A writer is waiting */
+#define XTENSA_RWLOCK_READERS     0x3fffffff  /* Number of readers */
+
+/* Static initializers */
+
+#define XTENSA_TICKETLOCK_INITIALIZER  { 0, 0 }
+#define XTENSA_MCSLOCK_INITIALIZER     { NULL }
+#define XTENSA_RWLOCK_INITIALIZER      { 0 }
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+struct xtensa_ticketlock_s
+{
+  volatile uint32_t next;         /* Next ticket to be handed out */
+  volatile uint32_t owner;        /* Ticket currently being served */
+};
+
+/* Each CPU waiting for or holding an MCS lock provides a queue node.  The
+ * node must remain valid until the lock is released; a stack variable in
+ * the function that takes and releases the lock is typical.
+ */
+
+struct xtensa_mcsnode_s
+{
+  struct xtensa_mcsnode_s * volatile next; /* Next waiter in the queue */
+  volatile uint32_t locked;                /* Non-zero while waiting */
+};
+
+struct xtensa_mcslock_s
+{
+  struct xtensa_mcsnode_s * volatile tail; /* Last waiter or NULL if free */
+};
+
+struct xtensa_rwlock_s
+{
+  volatile uint32_t value;        /* See XTENSA_RWLOCK_* */
+};
+
+/****************************************************************************
+ * Inline Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: xtensa_comparesetptr
+ *
+ * Description:
+ *   xtensa_compareset() for pointers.  Returns the old value of *addr.
+ *
+ ****************************************************************************/
+
+static inline void *xtensa_comparesetptr(void * volatile *addr,
+                                         void *compare, void *set)
+{
+#ifdef __XTENSA__
+  return (void *)xtensa_compareset((volatile uint32_t *)addr,
+                                   (uint32_t)compare, (uint32_t)set);
+#else
+  return __sync_val_compare_and_swap(addr, compare, set);
+#endif
+}
+
+/****************************************************************************
+ * Name: xtensa_spin_delay
+ *
+ * Description:
+ *   Busy wait for approximately 'count' iterations without touching
+ *   memory.
+ *
+ ****************************************************************************/
+
+static inline void xtensa_spin_delay(uint32_t count)
+{
+  while (count-- > 0)
+    {
+      __asm__ __volatile__ ("nop");
+    }
+}
+
+/****************************************************************************
+ * Name: xtensa_spin_backoff
+ *
+ * Description:
+ *   Delay for *backoff iterations, then double *backoff up to
+ *   XTENSA_SPIN_BACKOFF_MAX.  *backoff should start at
+ *   XTENSA_SPIN_BACKOFF_MIN.
+ *
+ ****************************************************************************/
+
+static inline void xtensa_spin_backoff(uint32_t *backoff)
+{
+  xtensa_spin_delay(*backoff);
+  if (*backoff < XTENSA_SPIN_BACKOFF_MAX)
+    {
+      *backoff <<= 1;
+    }
+}
+
+/****************************************************************************
+ * Name: xtensa_ticket_lock
+ *
+ * Description:
+ *   Take a ticket lock.  Waiters are granted the lock in the order that
+ *   they arrived.
+ *
+ ****************************************************************************/
+
+static inline void xtensa_ticket_lock(struct xtensa_ticketlock_s *lock)
+{
+  uint32_t ticket = xtensa_atomic_fetch_add(&lock->next, 1,
+                                            XTENSA_ATOMIC_RELAXED);
+  uint32_t ahead;
+
+  /* Wait in proportion to the number of CPUs ahead of us */
+
+  while ((ahead = ticket - lock->owner) != 0)
+    {
+      xtensa_spin_delay(ahead * XTENSA_SPIN_BACKOFF_MIN);
+    }
+
+  xtensa_memw();
+}
+
+/****************************************************************************
+ * Name: xtensa_ticket_trylock
+ *
+ * Description:
+ *   Take a ticket lock only if it is free.  Returns true if the lock was
+ *   taken.
+ *
+ ****************************************************************************/
+
+static inline bool xtensa_ticket_trylock(struct xtensa_ticketlock_s *lock)
+{
+  uint32_t owner = lock->owner;
+
+  if (lock->next != owner ||
+      xtensa_compareset(&lock->next, owner, owner + 1) != owner)
+    {
+      return false;
+    }
+
+  xtensa_memw();
+  return true;
+}
+
+/****************************************************************************
+ * Name: xtensa_ticket_unlock
+ *
+ * Description:
+ *   Release a ticket lock and pass it to the next waiter.
+ *
+ ****************************************************************************/
+
+static inline void xtensa_ticket_unlock(struct xtensa_ticketlock_s *lock)
+{
+  /* Only the holder modifies 'owner' so no atomic operation is needed */
+
+  xtensa_memw();
+  lock->owner = lock->owner + 1;
+}
+
+/****************************************************************************
+ * Name: xtensa_mcs_lock
+ *
+ * Description:
+ *   Take an MCS lock using the caller-provided queue node.  Waiters are
+ *   granted the lock in the order that they arrived.
+ *
+ ****************************************************************************/
+
+static inline void xtensa_mcs_lock(struct xtensa_mcslock_s *lock,
+                                   struct xtensa_mcsnode_s *node)
+{
+  struct xtensa_mcsnode_s *prev;
+
+  node->next   = NULL;
+  node->locked = 1;
+  xtensa_memw();
+
+  /* Atomically append our node to the queue */
+
+  do
+    {
+      prev = lock->tail;
+    }
+  while (xtensa_comparesetptr((void * volatile *)&lock->tail,
+                              prev, node) != prev);
+
+  if (prev != NULL)
+    {
+      /* Link behind our predecessor and wait for it to hand over */
+
+      prev->next = node;
+      while (node->locked)
+        {
+        }
+    }
+
+  xtensa_memw();
+}
+
+/****************************************************************************
+ * Name: xtensa_mcs_unlock
+ *
+ * Description:
+ *   Release an MCS lock taken with 'node' and pass it to the next waiter.
+ *
+ ****************************************************************************/
+
+static inline void xtensa_mcs_unlock(struct xtensa_mcslock_s *lock,
+                                     struct xtensa_mcsnode_s *node)
+{
+  struct xtensa_mcsnode_s *next;
+
+  xtensa_memw();
+
+  if (node->next == NULL)
+    {
+      /* No known successor:  Free the lock if we are still the tail */
+
+      if (xtensa_comparesetptr((void * volatile *)&lock->tail,
+                               node, NULL) == node)
+        {
+          return;
+        }
+
+      /* A successor has swapped itself in but is not yet linked */
+
+      while (node->next == NULL)
+        {
+        }
+    }
+
+  next         = node->next;
+  next->locked = 0;
+}
+
+/****************************************************************************
+ * Name: xtensa_rw_rdlock
+ *
+ * Description:
+ *   Take a reader-writer lock for reading.
+ *
+ ****************************************************************************/
+
+static inline void xtensa_rw_rdlock(struct xtensa_rwlock_s *lock)
+{
+  uint32_t backoff = XTENSA_SPIN_BACKOFF_MIN;
+  uint32_t value;
+
+  for (; ; )
+    {
+      value = lock->value;
+      if ((value & (XTENSA_RWLOCK_WRITER | XTENSA_RWLOCK_WAITING)) == 0 &&
+          xtensa_compareset(&lock->value, value, value + 1) == value)
+        {
+          break;
+        }
+
+      xtensa_spin_backoff(&backoff);
+    }
+
+  xtensa_memw();
+}
+
+/****************************************************************************
+ * Name: xtensa_rw_rdunlock
+ *
+ * Description:
+ *   Release a reader-writer lock held for reading.
+ *
+ ****************************************************************************/
+
+static inline void xtensa_rw_rdunlock(struct xtensa_rwlock_s *lock)
+{
+  xtensa_memw();
+  (void)xtensa_atomic_fetch_sub(&lock->value, 1, XTENSA_ATOMIC_RELAXED);
+}
+
+/****************************************************************************
+ * Name: xtensa_rw_wrlock
+ *
+ * Description:
+ *   Take a reader-writer lock for writing.  New readers are held off while
+ *   we wait for the current readers to leave.
+ *
+ ****************************************************************************/
+
+static inline void xtensa_rw_wrlock(struct xtensa_rwlock_s *lock)
+{
+  uint32_t backoff = XTENSA_SPIN_BACKOFF_MIN;
+  uint32_t value;
+
+  for (; ; )
+    {
+      value = lock->value;
+      if ((value & (XTENSA_RWLOCK_WRITER | XTENSA_RWLOCK_READERS)) == 0)
+        {
+          /* Free (possibly with writers waiting):  Try to take it */
+
+          if (xtensa_compareset(&lock->value, value,
+                                XTENSA_RWLOCK_WRITER) == value)
+            {
+              break;
+            }
+        }
+      else if ((value & XTENSA_RWLOCK_WAITING) == 0)
+        {
+          /* Busy:  Announce that a writer is waiting */
+
+          (void)xtensa_compareset(&lock->value, value,
+                                  value | XTENSA_RWLOCK_WAITING);
+        }
+
+      xtensa_spin_backoff(&backoff);
+    }
+
+  xtensa_memw();
+}
+
+/****************************************************************************
+ * Name: xtensa_rw_wrunlock
+ *
+ * Description:
+ *   Release a reader-writer lock held for writing.  Other waiting writers
+ *   will set XTENSA_RWLOCK_WAITING again.
+ *
+ ****************************************************************************/
+
+static inline void xtensa_rw_wrunlock(struct xtensa_rwlock_s *lock)
+{
+  xtensa_memw();
+  lock->value = 0;
+}
+
+#endif /* __ARCH_XTENSA_SRC_COMMON_XTENSA_SPINLOCK_H */
@@ -0,0 +1,383 @@
+/****************************************************************************
+ * arch/xtensa/src/common/xtensa_spinlock_bench.c
+ *
+ *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/* Host contention benchmark for the locks of xtensa_spinlock.h.
+ *
+ * Off target, the locks are built on the GCC __sync/__atomic fallbacks of
+ * <arch/xtensa/xtensa_atomic.h>.  For each lock type, a number of threads
+ * take and release the same lock for a fixed time.  Inside the critical
+ * section each thread checks that it is alone (that no writer is present
+ * for readers) and updates a shared counter non-atomically;  the counter
+ * must equal the number of acquisitions at the end.  Reported are:
+ *
+ *   - The acquisitions of each thread, and min/max between threads
+ *     (fairness: 1.00 is perfectly fair).
+ *   - The mean and worst acquire latency.
+ *
+ * Spinning waiters need a host CPU each:  With fewer host CPUs than
+ * threads, the holder is often preempted and the numbers mostly measure
+ * the host scheduler.
+ *
+ * This is not part of the NuttX build.  Build and run it on the host from
+ * the top of the tree with:
+ *
+ *   mkdir -p /tmp/xtensa_inc
+ *   ln -sfn "$PWD/arch/xtensa/include" /tmp/xtensa_inc/arch
+ *   gcc -O2 -Wall -pthread -I/tmp/xtensa_inc -o spinlock_bench \
+ *     arch/xtensa/src/common/xtensa_spinlock_bench.c
+ *   ./spinlock_bench [nthreads [milliseconds]]
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "xtensa_spinlock.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define MAX_THREADS       16
+#define DEFAULT_THREADS   2
+#define DEFAULT_MSEC      1000
+#define RW_WRITE_EVERY    4      /* Rwlock:  One write per this many reads */
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+enum bench_lock_e
+{
+  BENCH_TICKET = 0,
+  BENCH_MCS,
+  BENCH_RWLOCK,
+  BENCH_NLOCKS
+};
+
+struct bench_thread_s
+{
+  int       id;
+  uint64_t  acquired;           /* Acquisitions */
+  uint64_t  totalns;            /* Sum of the acquire latencies */
+  uint64_t  maxns;              /* Worst acquire latency */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const char *g_lockname[BENCH_NLOCKS] =
+{
+  "ticket", "mcs", "rwlock"
+};
+
+static struct xtensa_ticketlock_s g_ticket = XTENSA_TICKETLOCK_INITIALIZER;
+static struct xtensa_mcslock_s g_mcs = XTENSA_MCSLOCK_INITIALIZER;
+static struct xtensa_rwlock_s g_rwlock = XTENSA_RWLOCK_INITIALIZER;
+
+static enum bench_lock_e g_lock;
+static volatile bool g_start;
+static volatile bool g_stop;
+
+static volatile uint32_t g_inside;      /* Holders (readers or a writer) */
+static volatile uint32_t g_writer;      /* Non-zero while a writer holds */
+static volatile uint64_t g_counter;     /* Updated only by writers */
+static volatile uint64_t g_writes;      /* Write acquisitions */
+static volatile uint32_t g_violations;  /* Mutual exclusion failures */
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static uint64_t bench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* Critical section of a writer:  It must be alone */
+
+static void bench_write(void)
+{
+  uint64_t counter;
+
+  if (__atomic_fetch_add(&g_inside, 1, __ATOMIC_SEQ_CST) != 0)
+    {
+      __atomic_fetch_add(&g_violations, 1, __ATOMIC_SEQ_CST);
+    }
+
+  g_writer = 1;
+
+  /* A non-atomic update that loses counts unless writers are exclusive */
+
+  counter   = g_counter;
+  xtensa_spin_delay(10);
+  g_counter = counter + 1;
+  g_writes  = g_writes + 1;
+
+  g_writer = 0;
+  __atomic_fetch_sub(&g_inside, 1, __ATOMIC_SEQ_CST);
+}
+
+/* Critical section of a reader:  No writer may be present */
+
+static void bench_read(void)
+{
+  __atomic_fetch_add(&g_inside, 1, __ATOMIC_SEQ_CST);
+
+  if (g_writer != 0)
+    {
+      __atomic_fetch_add(&g_violations, 1, __ATOMIC_SEQ_CST);
+    }
+
+  xtensa_spin_delay(10);
+  __atomic_fetch_sub(&g_inside, 1, __ATOMIC_SEQ_CST);
+}
+
+static void *bench_thread(void *arg)
+{
+  struct bench_thread_s *me = (struct bench_thread_s *)arg;
+  struct xtensa_mcsnode_s node;
+  uint64_t start;
+  uint64_t ns;
+  bool write;
+
+  while (!g_start)
+    {
+    }
+
+  while (!g_stop)
+    {
+      write = g_lock != BENCH_RWLOCK ||
+              (me->acquired % RW_WRITE_EVERY) == 0;
+      start = bench_now();
+
+      switch (g_lock)
+        {
+          case BENCH_TICKET:
+            xtensa_ticket_lock(&g_ticket);
+            break;
+
+          case BENCH_MCS:
+            xtensa_mcs_lock(&g_mcs, &node);
+            break;
+
+          default:
+            if (write)
+              {
+                xtensa_rw_wrlock(&g_rwlock);
+              }
+            else
+              {
+                xtensa_rw_rdlock(&g_rwlock);
+              }
+            break;
+        }
+
+      ns = bench_now() - start;
+      me->totalns += ns;
+      if (ns > me->maxns)
+        {
+          me->maxns = ns;
+        }
+
+      me->acquired++;
+
+      if (write)
+        {
+          bench_write();
+        }
+      else
+        {
+          bench_read();
+        }
+
+      switch (g_lock)
+        {
+          case BENCH_TICKET:
+            xtensa_ticket_unlock(&g_ticket);
+            break;
+
+          case BENCH_MCS:
+            xtensa_mcs_unlock(&g_mcs, &node);
+            break;
+
+          default:
+            if (write)
+              {
+                xtensa_rw_wrunlock(&g_rwlock);
+              }
+            else
+              {
+                xtensa_rw_rdunlock(&g_rwlock);
+              }
+            break;
+        }
+    }
+
+  return NULL;
+}
+
+static bool bench_run(enum bench_lock_e lock, int nthreads, int msec)
+{
+  struct bench_thread_s threads[MAX_THREADS];
+  pthread_t tids[MAX_THREADS];
+  struct timespec duration;
+  uint64_t total = 0;
+  uint64_t totalns = 0;
+  uint64_t maxns = 0;
+  uint64_t minacq = UINT64_MAX;
+  uint64_t maxacq = 0;
+  bool ok;
+  int i;
+
+  g_lock       = lock;
+  g_start      = false;
+  g_stop       = false;
+  g_counter    = 0;
+  g_writes     = 0;
+  g_violations = 0;
+
+  memset(threads, 0, sizeof(threads));
+  for (i = 0; i < nthreads; i++)
+    {
+      threads[i].id = i;
+      if (pthread_create(&tids[i], NULL, bench_thread, &threads[i]) != 0)
+        {
+          perror("pthread_create");
+          exit(EXIT_FAILURE);
+        }
+    }
+
+  g_start = true;
+
+  duration.tv_sec  = msec / 1000;
+  duration.tv_nsec = (msec % 1000) * 1000000l;
+  nanosleep(&duration, NULL);
+  g_stop = true;
+
+  for (i = 0; i < nthreads; i++)
+    {
+      pthread_join(tids[i], NULL);
+    }
+
+  printf("%-7s", g_lockname[lock]);
+  for (i = 0; i < nthreads; i++)
+    {
+      total   += threads[i].acquired;
+      totalns += threads[i].totalns;
+
+      if (threads[i].maxns > maxns)
+        {
+          maxns = threads[i].maxns;
+        }
+
+      if (threads[i].acquired < minacq)
+        {
+          minacq = threads[i].acquired;
+        }
+
+      if (threads[i].acquired > maxacq)
+        {
+          maxacq = threads[i].acquired;
+        }
+
+      printf(" %9llu", (unsigned long long)threads[i].acquired);
+    }
+
+  ok = g_violations == 0 && g_counter == g_writes;
+
+  printf("  fairness %.2f  latency mean %llu ns max %llu ns  %s\n",
+         maxacq > 0 ? (double)minacq / (double)maxacq : 0.0,
+         (unsigned long long)(total > 0 ? totalns / total : 0),
+         (unsigned long long)maxns,
+         ok ? "OK" : "MUTUAL EXCLUSION FAILED");
+
+  return ok;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, char **argv)
+{
+  int nthreads = DEFAULT_THREADS;
+  int msec = DEFAULT_MSEC;
+  bool ok = true;
+  int lock;
+
+  if (argc > 1)
+    {
+      nthreads = atoi(argv[1]);
+    }
+
+  if (argc > 2)
+    {
+      msec = atoi(argv[2]);
+    }
+
+  if (nthreads < 1 || nthreads > MAX_THREADS || msec < 1)
+    {
+      fprintf(stderr, "Usage: %s [nthreads (1-%d) [milliseconds]]\n",
+              argv[0], MAX_THREADS);
+      return EXIT_FAILURE;
+    }
+
+  printf("%d threads, %d ms per lock type\n", nthreads, msec);
+
+  for (lock = 0; lock < BENCH_NLOCKS; lock++)
+    {
+      if (!bench_run((enum bench_lock_e)lock, nthreads, msec))
+        {
+          ok = false;
+        }
+    }
+
+  printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,232 @@
+/****************************************************************************
+ * arch/xtensa/src/common/xtensa_swstats.c
+ *
+ *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <nuttx/arch.h>
+#include <arch/irq.h>
+#include <arch/xtensa/xtensa_atomic.h>
+#include <arch/xtensa/xtensa_swstats.h>
+
+#include "xtensa.h"
+
+#ifdef CONFIG_XTENSA_SWITCH_STATS
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifdef CONFIG_SMP
+#  define NCPUS CONFIG_SMP_NCPUS
+#else
+#  define NCPUS 1
+#endif
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: xtensa_swstat_clear
+ *
+ * Description:
+ *   Discard the samples of this CPU.  Runs on the CPU that owns the
+ *   statistics, possibly from the inter-CPU interrupt.
+ *
+ ****************************************************************************/
+
+static int xtensa_swstat_clear(FAR void *arg)
+{
+  FAR struct xtensa_percpu_s *percpu = xtensa_percpu();
+  irqstate_t flags;
+
+  flags = up_irq_save();
+
+  percpu->swseq++;
+  xtensa_atomic_thread_fence(XTENSA_ATOMIC_RELEASE);
+
+  memset(percpu->swstat, 0, sizeof(percpu->swstat));
+
+  xtensa_atomic_thread_fence(XTENSA_ATOMIC_RELEASE);
+  percpu->swseq++;
+
+  up_irq_restore(flags);
+  return OK;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: xtensa_swstat_record
+ *
+ * Description:
+ *   Add one sample to a statistic of this CPU.
+ *
+ * Input Parameters:
+ *   stat   - One of XTENSA_SWSTAT_*
+ *   cycles - The duration of the operation in CCOUNT cycles
+ *
+ ****************************************************************************/
+
+void xtensa_swstat_record(int stat, uint32_t cycles)
+{
+  FAR struct xtensa_percpu_s *percpu = xtensa_percpu();
+  FAR struct xtensa_swstat_s *swstat = &percpu->swstat[stat];
+  irqstate_t flags;
+  int bin;
+
+  /* Bin n holds the samples with their most significant set bit at n */
+
+  bin = cycles == 0 ? 0 : 31 - __builtin_clz(cycles);
+  if (bin >= XTENSA_SWSTAT_NBINS)
+    {
+      bin = XTENSA_SWSTAT_NBINS - 1;
+    }
+
+  /* A nested interrupt could record a sample of its own */
+
+  flags = up_irq_save();
+
+  percpu->swseq++;
+  xtensa_atomic_thread_fence(XTENSA_ATOMIC_RELEASE);
+
+  /* min is not valid until the first sample */
+
+  if (swstat->count == 0 || cycles < swstat->min)
+    {
+      swstat->min = cycles;
+    }
+
+  if (cycles > swstat->max)
+    {
+      swstat->max = cycles;
+    }
+
+  swstat->count++;
+  swstat->total += cycles;
+  swstat->hist[bin]++;
+
+  xtensa_atomic_thread_fence(XTENSA_ATOMIC_RELEASE);
+  percpu->swseq++;
+
+  up_irq_restore(flags);
+}
+
+/****************************************************************************
+ * Name: xtensa_swstat_get
+ *
+ * Description:
+ *   Return a consistent copy of one statistic of one CPU.  The statistics
+ *   of the other CPU are copied again if that CPU updated them during the
+ *   copy.
+ *
+ * Input Parameters:
+ *   cpu    - The CPU index
+ *   stat   - One of XTENSA_SWSTAT_*
+ *   result - Location to return the statistic
+ *
+ * Returned Value:
+ *   Zero (OK) on success; -EINVAL if 'cpu' or 'stat' is out of range.
+ *
+ ****************************************************************************/
+
+int xtensa_swstat_get(int cpu, int stat, FAR struct xtensa_swstat_s *result)
+{
+  FAR struct xtensa_percpu_s *percpu;
+  irqstate_t flags;
+  uint32_t seq;
+
+  if (cpu < 0 || cpu >= NCPUS || stat < 0 || stat >= XTENSA_SWSTAT_NSTATS ||
+      result == NULL)
+    {
+      return -EINVAL;
+    }
+
+  percpu = &g_percpu[cpu];
+  flags  = up_irq_save();
+
+  do
+    {
+      seq = xtensa_atomic_load(&percpu->swseq, XTENSA_ATOMIC_ACQUIRE);
+      memcpy(result, &percpu->swstat[stat], sizeof(struct xtensa_swstat_s));
+      xtensa_atomic_thread_fence(XTENSA_ATOMIC_ACQUIRE);
+    }
+  while ((seq & 1) != 0 || seq != percpu->swseq);
+
+  up_irq_restore(flags);
+
+  if (result->count == 0)
+    {
+      result->min = 0;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: xtensa_swstat_reset
+ *
+ * Description:
+ *   Discard all samples of all CPUs.  With CONFIG_SMP, the statistics of
+ *   the other CPUs are cleared by those CPUs so this must not be called
+ *   from an interrupt handler or with interrupts disabled.
+ *
+ ****************************************************************************/
+
+void xtensa_swstat_reset(void)
+{
+#ifdef CONFIG_SMP
+  int cpu;
+
+  for (cpu = 0; cpu < CONFIG_SMP_NCPUS; cpu++)
+    {
+      (void)xtensa_cpu_call(cpu, xtensa_swstat_clear, NULL);
+    }
+#else
+  (void)xtensa_swstat_clear(NULL);
+#endif
+}
+
+#endif /* CONFIG_XTENSA_SWITCH_STATS */
@@ -41,46 +41,12 @@
 
 #include <nuttx/spinlock.h>
 #include <arch/spinlock.h>
+#include <arch/xtensa/xtensa_atomic.h>
 
 #include "xtensa.h"
 
 #ifdef CONFIG_SPINLOCK
 
-/****************************************************************************
- * Private Functions
- ****************************************************************************/
-
-/****************************************************************************
- * Name: xtensa_compareset
- *
- * Description:
- *   Wrapper for the Xtensa compare-and-set instruction. This function will
- *   atomically compare *addr to compare, and if it's the same, will set
- *   *addr to set. It will return the old value of *addr.
- *
- *   Warning: From the ISA docs: in some (unspecified) cases, the s32c1i
- *   instruction may return the *bitwise inverse* of the old mem if the
- *   mem wasn't written. This doesn't seem to happen on the ESP32, though.
- *   (Would show up directly if it did because the magic wouldn't match.)
- *
- ****************************************************************************/
-
-static inline uint32_t xtensa_compareset(FAR volatile uint32_t *addr,
-                                         uint32_t compare,
-                                         uint32_t set)
-{
-  __asm__ __volatile__
-  (
-    "WSR    %2, SCOMPARE1\n" /* Initialize SCOMPARE1 */
-    "ISYNC\n"                /* Wait sync */
-    "S32C1I %0, %1, 0\n"     /* Store id into the lock, if the lock is the
-                              * same as comparel. Otherwise, no write-access */
-    : "=r"(set) : "r"(addr), "r"(compare), "0"(set)
-  );
-
-  return set;
-}
-
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -98,6 +98,10 @@ void up_unblock_task(struct tcb_s *tcb)
 
       sched_suspend_scheduler(rtcb);
 
+      /* Start timing a synchronous switch (if not in an interrupt) */
+
+      xtensa_swstat_mark();
+
       /* Are we in an interrupt handler? */
 
       if (CURRENT_REGS)
@@ -138,7 +142,7 @@ void up_unblock_task(struct tcb_s *tcb)
            * processor save area.
            */
 
-          xtensa_coproc_savestate(&rtcb->xcp.cpstate);
+          xtensa_coproc_switchout(&rtcb->xcp.cpstate);
 #endif
 
           /* Restore the exception context of the new task that is ready to
@@ -151,7 +155,7 @@ void up_unblock_task(struct tcb_s *tcb)
 #if XCHAL_CP_NUM > 0
           /* Set up the co-processor state for the newly started thread. */
 
-          xtensa_coproc_restorestate(&rtcb->xcp.cpstate);
+          xtensa_coproc_switchin(&rtcb->xcp.cpstate);
 #endif
 
 #ifdef CONFIG_ARCH_ADDRENV
@@ -169,6 +173,7 @@ void up_unblock_task(struct tcb_s *tcb)
 
           /* Then switch contexts */
 
+          xtensa_swstat_since(XTENSA_SWSTAT_SYNC);
           xtensa_context_restore(rtcb->xcp.regs);
         }
     }
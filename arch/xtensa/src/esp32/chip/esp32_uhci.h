@@ -0,0 +1,473 @@
+/****************************************************************************
+ * arch/xtensa/src/esp32/chip/esp32_uhci.h
+ *
+ * Adapted from use in NuttX by:
+ *
+ *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Derives from logic originally provided by Espressif Systems:
+ *
+ *   Copyright 2015-2016 Espressif Systems (Shanghai) PTE LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __ARCH_XTENSA_SRC_ESP32_CHIP_ESP32_UHCI_H
+#define __ARCH_XTENSA_SRC_ESP32_CHIP_ESP32_UHCI_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include "chip/esp32_soc.h"
+
+/****************************************************************************
+ * Pre-processor Macros
+ ****************************************************************************/
+
+#define REG_UHCI_BASE(i)                 (DR_REG_UHCI0_BASE - (i) * 0x8000)
+
+#define UHCI_CONF0_OFFSET                0x00
+#define UHCI_CONF0_REG(i)                (REG_UHCI_BASE(i) + UHCI_CONF0_OFFSET)
+
+/* UHCI_UART_RX_BRK_EOF_EN : R/W ;bitpos:[23] ;default: 1'b0 ; */
+/* Description: Set this bit to enable to use brk char as the end of a data
+ * frame.
+ */
+
+#define UHCI_UART_RX_BRK_EOF_EN          (BIT(23))
+#define UHCI_UART_RX_BRK_EOF_EN_M        (BIT(23))
+#define UHCI_UART_RX_BRK_EOF_EN_V        0x1
+#define UHCI_UART_RX_BRK_EOF_EN_S        23
+
+/* UHCI_CLK_EN : R/W ;bitpos:[22] ;default: 1'b0 ; */
+/* Description: Set this bit to enable clock-gating for read or write
+ * registers.
+ */
+
+#define UHCI_CLK_EN                      (BIT(22))
+#define UHCI_CLK_EN_M                    (BIT(22))
+#define UHCI_CLK_EN_V                    0x1
+#define UHCI_CLK_EN_S                    22
+
+/* UHCI_ENCODE_CRC_EN : R/W ;bitpos:[21] ;default: 1'b1 ; */
+/* Description: Set this bit to enable crc calculation for data frame when
+ * bit6 in the head packet is 1.
+ */
+
+#define UHCI_ENCODE_CRC_EN               (BIT(21))
+#define UHCI_ENCODE_CRC_EN_M             (BIT(21))
+#define UHCI_ENCODE_CRC_EN_V             0x1
+#define UHCI_ENCODE_CRC_EN_S             21
+
+/* UHCI_LEN_EOF_EN : R/W ;bitpos:[20] ;default: 1'b1 ; */
+/* Description: Set this bit to enable to use packet_len in packet head when
+ * the received data is equal to packet_len this means the end of a packet.
+ */
+
+#define UHCI_LEN_EOF_EN                  (BIT(20))
+#define UHCI_LEN_EOF_EN_M                (BIT(20))
+#define UHCI_LEN_EOF_EN_V                0x1
+#define UHCI_LEN_EOF_EN_S                20
+
+/* UHCI_UART_IDLE_EOF_EN : R/W ;bitpos:[19] ;default: 1'b0 ; */
+/* Description: Set this bit to enable to use idle time when the idle time
+ * after data frame is satisfied this means the end of a data frame.
+ */
+
+#define UHCI_UART_IDLE_EOF_EN            (BIT(19))
+#define UHCI_UART_IDLE_EOF_EN_M          (BIT(19))
+#define UHCI_UART_IDLE_EOF_EN_V          0x1
+#define UHCI_UART_IDLE_EOF_EN_S          19
+
+/* UHCI_CRC_REC_EN : R/W ;bitpos:[18] ;default: 1'b1 ; */
+/* Description: Set this bit to enable receiver's ability of crc
+ * calculation.
+ */
+
+#define UHCI_CRC_REC_EN                  (BIT(18))
+#define UHCI_CRC_REC_EN_M                (BIT(18))
+#define UHCI_CRC_REC_EN_V                0x1
+#define UHCI_CRC_REC_EN_S                18
+
+/* UHCI_HEAD_EN : R/W ;bitpos:[17] ;default: 1'b1 ; */
+/* Description: Set this bit to enable to use head packet before the data
+ * frame.
+ */
+
+#define UHCI_HEAD_EN                     (BIT(17))
+#define UHCI_HEAD_EN_M                   (BIT(17))
+#define UHCI_HEAD_EN_V                   0x1
+#define UHCI_HEAD_EN_S                   17
+
+/* UHCI_SEPER_EN : R/W ;bitpos:[16] ;default: 1'b1 ; */
+/* Description: Set this bit to use special char to separate the data
+ * frame.
+ */
+
+#define UHCI_SEPER_EN                    (BIT(16))
+#define UHCI_SEPER_EN_M                  (BIT(16))
+#define UHCI_SEPER_EN_V                  0x1
+#define UHCI_SEPER_EN_S                  16
+
+/* UHCI_UART2_CE : R/W ;bitpos:[11] ;default: 1'b0 ; */
+/* Description: Set this bit to use UART2 to transmit or receive data. */
+
+#define UHCI_UART2_CE                    (BIT(11))
+#define UHCI_UART2_CE_M                  (BIT(11))
+#define UHCI_UART2_CE_V                  0x1
+#define UHCI_UART2_CE_S                  11
+
+/* UHCI_UART1_CE : R/W ;bitpos:[10] ;default: 1'b0 ; */
+/* Description: Set this bit to use UART1 to transmit or receive data. */
+
+#define UHCI_UART1_CE                    (BIT(10))
+#define UHCI_UART1_CE_M                  (BIT(10))
+#define UHCI_UART1_CE_V                  0x1
+#define UHCI_UART1_CE_S                  10
+
+/* UHCI_UART0_CE : R/W ;bitpos:[9] ;default: 1'b0 ; */
+/* Description: Set this bit to use UART to transmit or receive data. */
+
+#define UHCI_UART0_CE                    (BIT(9))
+#define UHCI_UART0_CE_M                  (BIT(9))
+#define UHCI_UART0_CE_V                  0x1
+#define UHCI_UART0_CE_S                  9
+
+/* UHCI_OUT_EOF_MODE : R/W ;bitpos:[8] ;default: 1'b1 ; */
+/* Description: Set this bit to produce eof after DMA pops all data clear
+ * this bit to produce eof after DMA pushes all data
+ */
+
+#define UHCI_OUT_EOF_MODE                (BIT(8))
+#define UHCI_OUT_EOF_MODE_M              (BIT(8))
+#define UHCI_OUT_EOF_MODE_V              0x1
+#define UHCI_OUT_EOF_MODE_S              8
+
+/* UHCI_OUT_AUTO_WRBACK : R/W ;bitpos:[6] ;default: 1'b0 ; */
+/* Description: when in link's length is 0 go on to use the next in link
+ * automatically.
+ */
+
+#define UHCI_OUT_AUTO_WRBACK             (BIT(6))
+#define UHCI_OUT_AUTO_WRBACK_M           (BIT(6))
+#define UHCI_OUT_AUTO_WRBACK_V           0x1
+#define UHCI_OUT_AUTO_WRBACK_S           6
+
+/* UHCI_AHBM_RST : R/W ;bitpos:[3] ;default: 1'b0 ; */
+/* Description: Set this bit to reset dma ahb interface. */
+
+#define UHCI_AHBM_RST                    (BIT(3))
+#define UHCI_AHBM_RST_M                  (BIT(3))
+#define UHCI_AHBM_RST_V                  0x1
+#define UHCI_AHBM_RST_S                  3
+
+/* UHCI_AHBM_FIFO_RST : R/W ;bitpos:[2] ;default: 1'b0 ; */
+/* Description: Set this bit to reset dma ahb fifo. */
+
+#define UHCI_AHBM_FIFO_RST               (BIT(2))
+#define UHCI_AHBM_FIFO_RST_M             (BIT(2))
+#define UHCI_AHBM_FIFO_RST_V             0x1
+#define UHCI_AHBM_FIFO_RST_S             2
+
+/* UHCI_OUT_RST : R/W ;bitpos:[1] ;default: 1'b0 ; */
+/* Description: Set this bit to reset out link operations. */
+
+#define UHCI_OUT_RST                     (BIT(1))
+#define UHCI_OUT_RST_M                   (BIT(1))
+#define UHCI_OUT_RST_V                   0x1
+#define UHCI_OUT_RST_S                   1
+
+/* UHCI_IN_RST : R/W ;bitpos:[0] ;default: 1'b0 ; */
+/* Description: Set this bit to reset in link operations. */
+
+#define UHCI_IN_RST                      (BIT(0))
+#define UHCI_IN_RST_M                    (BIT(0))
+#define UHCI_IN_RST_V                    0x1
+#define UHCI_IN_RST_S                    0
+
+/* Interrupt registers.  The raw, status, enable and clear registers share
+ * the same bit layout.
+ */
+
+#define UHCI_INT_RAW_OFFSET              0x04
+#define UHCI_INT_RAW_REG(i)              (REG_UHCI_BASE(i) + UHCI_INT_RAW_OFFSET)
+
+#define UHCI_INT_ST_OFFSET               0x08
+#define UHCI_INT_ST_REG(i)               (REG_UHCI_BASE(i) + UHCI_INT_ST_OFFSET)
+
+#define UHCI_INT_ENA_OFFSET              0x0c
+#define UHCI_INT_ENA_REG(i)              (REG_UHCI_BASE(i) + UHCI_INT_ENA_OFFSET)
+
+#define UHCI_INT_CLR_OFFSET              0x10
+#define UHCI_INT_CLR_REG(i)              (REG_UHCI_BASE(i) + UHCI_INT_CLR_OFFSET)
+
+/* UHCI_OUT_TOTAL_EOF_INT : bitpos:[13] ;default: 1'b0 ; */
+/* Description: When all data have been send, this interrupt will be
+ * triggered.
+ */
+
+#define UHCI_OUT_TOTAL_EOF_INT           (BIT(13))
+#define UHCI_OUT_TOTAL_EOF_INT_M         (BIT(13))
+#define UHCI_OUT_TOTAL_EOF_INT_V         0x1
+#define UHCI_OUT_TOTAL_EOF_INT_S         13
+
+/* UHCI_OUTLINK_EOF_ERR_INT : bitpos:[12] ;default: 1'b0 ; */
+/* Description: This interrupt is triggered when there are some errors
+ * about eof in outlink descriptor.
+ */
+
+#define UHCI_OUTLINK_EOF_ERR_INT         (BIT(12))
+#define UHCI_OUTLINK_EOF_ERR_INT_M       (BIT(12))
+#define UHCI_OUTLINK_EOF_ERR_INT_V       0x1
+#define UHCI_OUTLINK_EOF_ERR_INT_S       12
+
+/* UHCI_IN_DSCR_EMPTY_INT : bitpos:[11] ;default: 1'b0 ; */
+/* Description: This interrupt is triggered when there are not enough in
+ * links for DMA.
+ */
+
+#define UHCI_IN_DSCR_EMPTY_INT           (BIT(11))
+#define UHCI_IN_DSCR_EMPTY_INT_M         (BIT(11))
+#define UHCI_IN_DSCR_EMPTY_INT_V         0x1
+#define UHCI_IN_DSCR_EMPTY_INT_S         11
+
+/* UHCI_OUT_DSCR_ERR_INT : bitpos:[10] ;default: 1'b0 ; */
+/* Description: This interrupt is triggered when there are some errors
+ * about the out link descriptor.
+ */
+
+#define UHCI_OUT_DSCR_ERR_INT            (BIT(10))
+#define UHCI_OUT_DSCR_ERR_INT_M          (BIT(10))
+#define UHCI_OUT_DSCR_ERR_INT_V          0x1
+#define UHCI_OUT_DSCR_ERR_INT_S          10
+
+/* UHCI_IN_DSCR_ERR_INT : bitpos:[9] ;default: 1'b0 ; */
+/* Description: This interrupt is triggered when there are some errors
+ * about the in link descriptor.
+ */
+
+#define UHCI_IN_DSCR_ERR_INT             (BIT(9))
+#define UHCI_IN_DSCR_ERR_INT_M           (BIT(9))
+#define UHCI_IN_DSCR_ERR_INT_V           0x1
+#define UHCI_IN_DSCR_ERR_INT_S           9
+
+/* UHCI_OUT_EOF_INT : bitpos:[8] ;default: 1'b0 ; */
+/* Description: This interrupt is triggered when the current descriptor's
+ * eof bit is 1.
+ */
+
+#define UHCI_OUT_EOF_INT                 (BIT(8))
+#define UHCI_OUT_EOF_INT_M               (BIT(8))
+#define UHCI_OUT_EOF_INT_V               0x1
+#define UHCI_OUT_EOF_INT_S               8
+
+/* UHCI_OUT_DONE_INT : bitpos:[7] ;default: 1'b0 ; */
+/* Description: This interrupt is triggered when a out link descriptor is
+ * completed.
+ */
+
+#define UHCI_OUT_DONE_INT                (BIT(7))
+#define UHCI_OUT_DONE_INT_M              (BIT(7))
+#define UHCI_OUT_DONE_INT_V              0x1
+#define UHCI_OUT_DONE_INT_S              7
+
+/* UHCI_IN_ERR_EOF_INT : bitpos:[6] ;default: 1'b0 ; */
+/* Description: This interrupt is triggered when there are some errors
+ * about eof in in link descriptor.
+ */
+
+#define UHCI_IN_ERR_EOF_INT              (BIT(6))
+#define UHCI_IN_ERR_EOF_INT_M            (BIT(6))
+#define UHCI_IN_ERR_EOF_INT_V            0x1
+#define UHCI_IN_ERR_EOF_INT_S            6
+
+/* UHCI_IN_SUC_EOF_INT : bitpos:[5] ;default: 1'b0 ; */
+/* Description: This interrupt is triggered when a data packet has been
+ * received.
+ */
+
+#define UHCI_IN_SUC_EOF_INT              (BIT(5))
+#define UHCI_IN_SUC_EOF_INT_M            (BIT(5))
+#define UHCI_IN_SUC_EOF_INT_V            0x1
+#define UHCI_IN_SUC_EOF_INT_S            5
+
+/* UHCI_IN_DONE_INT : bitpos:[4] ;default: 1'b0 ; */
+/* Description: This interrupt is triggered when a in link descriptor is
+ * completed.
+ */
+
+#define UHCI_IN_DONE_INT                 (BIT(4))
+#define UHCI_IN_DONE_INT_M               (BIT(4))
+#define UHCI_IN_DONE_INT_V               0x1
+#define UHCI_IN_DONE_INT_S               4
+
+#define UHCI_DMA_OUT_LINK_OFFSET         0x24
+#define UHCI_DMA_OUT_LINK_REG(i)         (REG_UHCI_BASE(i) + UHCI_DMA_OUT_LINK_OFFSET)
+
+/* UHCI_OUTLINK_PARK : RO ;bitpos:[31] ;default: 1'h0 ; */
+/* Description: 1: the out link descriptor's fsm is in idle state. */
+
+#define UHCI_OUTLINK_PARK                (BIT(31))
+#define UHCI_OUTLINK_PARK_M              (BIT(31))
+#define UHCI_OUTLINK_PARK_V              0x1
+#define UHCI_OUTLINK_PARK_S              31
+
+/* UHCI_OUTLINK_RESTART : R/W ;bitpos:[30] ;default: 1'b0 ; */
+/* Description: Set this bit to mount on new out link descriptors */
+
+#define UHCI_OUTLINK_RESTART             (BIT(30))
+#define UHCI_OUTLINK_RESTART_M           (BIT(30))
+#define UHCI_OUTLINK_RESTART_V           0x1
+#define UHCI_OUTLINK_RESTART_S           30
+
+/* UHCI_OUTLINK_START : R/W ;bitpos:[29] ;default: 1'b0 ; */
+/* Description: Set this bit to start dealing with the out link
+ * descriptors.
+ */
+
+#define UHCI_OUTLINK_START               (BIT(29))
+#define UHCI_OUTLINK_START_M             (BIT(29))
+#define UHCI_OUTLINK_START_V             0x1
+#define UHCI_OUTLINK_START_S             29
+
+/* UHCI_OUTLINK_STOP : R/W ;bitpos:[28] ;default: 1'b0 ; */
+/* Description: Set this bit to stop dealing with the out link
+ * descriptors.
+ */
+
+#define UHCI_OUTLINK_STOP                (BIT(28))
+#define UHCI_OUTLINK_STOP_M              (BIT(28))
+#define UHCI_OUTLINK_STOP_V              0x1
+#define UHCI_OUTLINK_STOP_S              28
+
+/* UHCI_OUTLINK_ADDR : R/W ;bitpos:[19:0] ;default: 20'h0 ; */
+/* Description: This register stores the least 20 bits of the first out
+ * link descriptor's address.
+ */
+
+#define UHCI_OUTLINK_ADDR                0x000FFFFF
+#define UHCI_OUTLINK_ADDR_M              ((UHCI_OUTLINK_ADDR_V) << (UHCI_OUTLINK_ADDR_S))
+#define UHCI_OUTLINK_ADDR_V              0xFFFFF
+#define UHCI_OUTLINK_ADDR_S              0
+
+#define UHCI_DMA_IN_LINK_OFFSET          0x28
+#define UHCI_DMA_IN_LINK_REG(i)          (REG_UHCI_BASE(i) + UHCI_DMA_IN_LINK_OFFSET)
+
+/* UHCI_INLINK_PARK : RO ;bitpos:[31] ;default: 1'h0 ; */
+/* Description: 1:the in link descriptor's fsm is in idle state. */
+
+#define UHCI_INLINK_PARK                 (BIT(31))
+#define UHCI_INLINK_PARK_M               (BIT(31))
+#define UHCI_INLINK_PARK_V               0x1
+#define UHCI_INLINK_PARK_S               31
+
+/* UHCI_INLINK_RESTART : R/W ;bitpos:[30] ;default: 1'b0 ; */
+/* Description: Set this bit to mount on new in link descriptors */
+
+#define UHCI_INLINK_RESTART              (BIT(30))
+#define UHCI_INLINK_RESTART_M            (BIT(30))
+#define UHCI_INLINK_RESTART_V            0x1
+#define UHCI_INLINK_RESTART_S            30
+
+/* UHCI_INLINK_START : R/W ;bitpos:[29] ;default: 1'b0 ; */
+/* Description: Set this bit to start dealing with the in link
+ * descriptors.
+ */
+
+#define UHCI_INLINK_START                (BIT(29))
+#define UHCI_INLINK_START_M              (BIT(29))
+#define UHCI_INLINK_START_V              0x1
+#define UHCI_INLINK_START_S              29
+
+/* UHCI_INLINK_STOP : R/W ;bitpos:[28] ;default: 1'b0 ; */
+/* Description: Set this bit to stop dealing with the in link
+ * descriptors.
+ */
+
+#define UHCI_INLINK_STOP                 (BIT(28))
+#define UHCI_INLINK_STOP_M               (BIT(28))
+#define UHCI_INLINK_STOP_V               0x1
+#define UHCI_INLINK_STOP_S               28
+
+/* UHCI_INLINK_AUTO_RET : R/W ;bitpos:[20] ;default: 1'b1 ; */
+/* Description: 1:when a packet is wrong in link descriptor returns to the
+ * descriptor which is lately used.
+ */
+
+#define UHCI_INLINK_AUTO_RET             (BIT(20))
+#define UHCI_INLINK_AUTO_RET_M           (BIT(20))
+#define UHCI_INLINK_AUTO_RET_V           0x1
+#define UHCI_INLINK_AUTO_RET_S           20
+
+/* UHCI_INLINK_ADDR : R/W ;bitpos:[19:0] ;default: 20'h0 ; */
+/* Description: This register stores the 20 least significant bits of the
+ * first in link descriptor's address.
+ */
+
+#define UHCI_INLINK_ADDR                 0x000FFFFF
+#define UHCI_INLINK_ADDR_M               ((UHCI_INLINK_ADDR_V) << (UHCI_INLINK_ADDR_S))
+#define UHCI_INLINK_ADDR_V               0xFFFFF
+#define UHCI_INLINK_ADDR_S               0
+
+#define UHCI_CONF1_OFFSET                0x2c
+#define UHCI_CONF1_REG(i)                (REG_UHCI_BASE(i) + UHCI_CONF1_OFFSET)
+
+/* UHCI_CHECK_SEQ_EN : R/W ;bitpos:[1] ;default: 1'b1 ; */
+/* Description: Set this bit to enable decoder to check seq num in packet
+ * head.
+ */
+
+#define UHCI_CHECK_SEQ_EN                (BIT(1))
+#define UHCI_CHECK_SEQ_EN_M              (BIT(1))
+#define UHCI_CHECK_SEQ_EN_V              0x1
+#define UHCI_CHECK_SEQ_EN_S              1
+
+/* UHCI_CHECK_SUM_EN : R/W ;bitpos:[0] ;default: 1'b1 ; */
+/* Description: Set this bit to enable decoder to check check_sum in packet
+ * head.
+ */
+
+#define UHCI_CHECK_SUM_EN                (BIT(0))
+#define UHCI_CHECK_SUM_EN_M              (BIT(0))
+#define UHCI_CHECK_SUM_EN_V              0x1
+#define UHCI_CHECK_SUM_EN_S              0
+
+#define UHCI_ESCAPE_CONF_OFFSET          0x64
+#define UHCI_ESCAPE_CONF_REG(i)          (REG_UHCI_BASE(i) + UHCI_ESCAPE_CONF_OFFSET)
+
+/* The ESCAPE_CONF register enables SLIP style escaping of the 0xc0, 0xdb,
+ * 0x11 and 0x13 characters in each direction.  Bits [7:0] enable the
+ * individual decoder (RX) and encoder (TX) escapes.
+ */
+
+#define UHCI_ESCAPE_ALL                  0x000000FF
+
+/* DMA linked list descriptors.  Each descriptor is three words:  A control
+ * word, the address of the data buffer, and the address of the next
+ * descriptor (or zero).  Receive (in link) buffers must be word aligned
+ * and their size a multiple of four bytes.
+ */
+
+#define DMA_DESC_OWNER                   (BIT(31)) /* 1=DMA owns descriptor */
+#define DMA_DESC_EOF                     (BIT(30)) /* Last descriptor of frame */
+#define DMA_DESC_SOSF                    (BIT(29))
+#define DMA_DESC_LENGTH_S                12        /* Bytes valid in buffer */
+#define DMA_DESC_LENGTH_M                (0xfff << DMA_DESC_LENGTH_S)
+#define DMA_DESC_SIZE_S                  0         /* Size of the buffer */
+#define DMA_DESC_SIZE_M                  (0xfff << DMA_DESC_SIZE_S)
+#define DMA_DESC_MAXSIZE                 4092
+
+#endif /* __ARCH_XTENSA_SRC_ESP32_CHIP_ESP32_UHCI_H */
@@ -0,0 +1,141 @@
+/****************************************************************************
+ * arch/xtensa/src/esp32/esp32_autobaud.c
+ *
+ *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/* This file depends on neither NuttX nor the hardware so that the rate
+ * estimation can be built and exercised on the host.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdint.h>
+
+#include "esp32_autobaud.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Value of the pulse counters before any pulse has been measured */
+
+#define AUTOBAUD_NOPULSE   0x000fffff
+
+/* Estimates within 3% of a standard rate are rounded to it */
+
+#define AUTOBAUD_TOLERANCE 33
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const uint32_t g_stdrates[] =
+{
+  1200, 2400, 4800, 9600, 14400, 19200, 28800, 38400, 57600, 74880,
+  115200, 230400, 250000, 460800, 500000, 921600, 1000000, 1500000,
+  2000000, 3000000, 4000000, 5000000
+};
+
+#define NSTDRATES (sizeof(g_stdrates) / sizeof(g_stdrates[0]))
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: esp32_autobaud_rate
+ *
+ * Description:
+ *   Estimate the baud rate from the UART autobaud pulse counters.
+ *
+ *   The counters hold the shortest low and high levels seen on RXD, one
+ *   bit time each once the data contained an isolated 0 and an isolated 1
+ *   bit.  Both are averaged to cancel the asymmetry of the line.  If one
+ *   of them is still half again longer than the other, it spans several
+ *   bits and only the shorter one is used.
+ *
+ ****************************************************************************/
+
+uint32_t esp32_autobaud_rate(uint32_t clkfreq, uint32_t lowpulse,
+                             uint32_t highpulse)
+{
+  uint32_t period;
+  uint32_t rate;
+  uint32_t delta;
+  unsigned int i;
+
+  lowpulse  &= AUTOBAUD_NOPULSE;
+  highpulse &= AUTOBAUD_NOPULSE;
+
+  if (lowpulse == AUTOBAUD_NOPULSE && highpulse == AUTOBAUD_NOPULSE)
+    {
+      return 0;
+    }
+
+  /* The counters hold the pulse width minus one clock */
+
+  lowpulse++;
+  highpulse++;
+
+  if (2 * lowpulse >= 3 * highpulse)
+    {
+      period = highpulse;
+    }
+  else if (2 * highpulse >= 3 * lowpulse)
+    {
+      period = lowpulse;
+    }
+  else
+    {
+      period = (lowpulse + highpulse + 1) / 2;
+    }
+
+  rate = (clkfreq + period / 2) / period;
+
+  /* Round to the nearest standard rate if close enough */
+
+  for (i = 0; i < NSTDRATES; i++)
+    {
+      delta = rate > g_stdrates[i] ? rate - g_stdrates[i] :
+                                     g_stdrates[i] - rate;
+
+      if (delta <= g_stdrates[i] / AUTOBAUD_TOLERANCE)
+        {
+          return g_stdrates[i];
+        }
+    }
+
+  return rate;
+}
@@ -1,5 +1,5 @@
 /****************************************************************************
- * arch/xtensa/src/common/xtensa_copystate.c
+ * arch/xtensa/src/esp32/esp32_autobaud.h
  *
  *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <gnutt@nuttx.org>
@@ -33,42 +33,37 @@
  *
  ****************************************************************************/
 
+#ifndef __ARCH_XTENSA_SRC_ESP32_ESP32_AUTOBAUD_H
+#define __ARCH_XTENSA_SRC_ESP32_ESP32_AUTOBAUD_H
+
 /****************************************************************************
  * Included Files
  ****************************************************************************/
 
-#include <nuttx/config.h>
-
 #include <stdint.h>
-#include <arch/irq.h>
-
-#include "xtensa.h"
 
 /****************************************************************************
- * Public Functions
+ * Public Function Prototypes
  ****************************************************************************/
 
 /****************************************************************************
- * Name: xtensa_copystate
+ * Name: esp32_autobaud_rate
+ *
+ * Description:
+ *   Estimate the baud rate from the UART autobaud pulse counters.
+ *
+ * Input Parameters:
+ *   clkfreq   - The UART source clock frequency (Hz)
+ *   lowpulse  - UART_LOWPULSE_MIN_CNT:  Shortest low pulse (clocks - 1)
+ *   highpulse - UART_HIGHPULSE_MIN_CNT:  Shortest high pulse (clocks - 1)
+ *
+ * Returned Value:
+ *   The baud rate, rounded to a standard rate when within 3% of one, or
+ *   zero if the counters do not yet hold a usable measurement.
+ *
  ****************************************************************************/
 
-/* A little faster than most memcpy's */
-
-void xtensa_copystate(uint32_t *dest, uint32_t *src)
-{
-  int i;
-
-  /* In the XTENSA model, the state is copied from the stack to the TCB,
-   * but only a reference is passed to get the state from the TCB.  So the
-   * following check avoids copying the TCB save area onto itself:
-   */
-
-  if (src != dest)
-    {
-      for (i = 0; i < XCPTCONTEXT_REGS; i++)
-        {
-          *dest++ = *src++;
-        }
-    }
-}
+uint32_t esp32_autobaud_rate(uint32_t clkfreq, uint32_t lowpulse,
+                             uint32_t highpulse);
 
+#endif /* __ARCH_XTENSA_SRC_ESP32_ESP32_AUTOBAUD_H */
@@ -1,5 +1,5 @@
 /****************************************************************************
- * arch/xtensa/src/esp32/esp32_irq.c
+ * arch/xtensa/src/esp32/esp32_cpuint.c
  *
  *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
  *   Author: Gregory Nutt <gnutt@nuttx.org>
@@ -40,6 +40,7 @@
 #include <nuttx/config.h>
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <assert.h>
 #include <errno.h>
 #include <debug.h>
@@ -50,6 +51,8 @@
 
 #include "chip/esp32_dport.h"
 #include "esp32_cpuint.h"
+#include "esp32_intalloc.h"
+#include "esp32_gpio.h"
 #include "xtensa.h"
 
 /****************************************************************************
@@ -147,6 +150,61 @@
 #define ESP32_MAX_PRIORITY     5
 #define ESP32_PRIO_INDEX(p)    ((p) - ESP32_MIN_PRIORITY)
 
+/* All CPU interrupts that can be attached to peripherals */
+
+#define ESP32_CPUINT_PERIPHSET (EPS32_CPUINT_LEVELSET | EPS32_CPUINT_EDGESET)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* This structure describes the current routing of one peripheral interrupt
+ * source through the interrupt matrix.
+ */
+
+struct esp32_periphmap_s
+{
+  uint8_t flags;                /* See ESP32_PERIPH_* flags */
+  uint8_t cpu;                  /* CPU receiving the peripheral interrupt */
+  uint8_t cpuint;               /* CPU interrupt on that CPU */
+#ifdef CONFIG_SMP
+  uint8_t newcpu;               /* Pending migration:  Target CPU */
+  uint8_t newint;               /* Pending migration:  Target CPU interrupt */
+#endif
+};
+
+/* Values for struct esp32_periphmap_s flags */
+
+#define ESP32_PERIPH_ATTACHED  (1 << 0) /* Peripheral is attached to a CPU */
+#define ESP32_PERIPH_MOVABLE   (1 << 1) /* May be moved to the other CPU */
+#define ESP32_PERIPH_MIGRATE   (1 << 2) /* Migration to newcpu is pending */
+#define ESP32_PERIPH_SHARED    (1 << 3) /* CPU interrupt is shared */
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+#ifdef CONFIG_ESP32_IRQ_BALANCE
+/* Decayed count of interrupts taken from each peripheral.  Incremented by
+ * xtensa_int_decode(), halved by each call to esp32_irq_rebalance().
+ */
+
+volatile uint32_t g_periph_load[ESP32_NPERIPHERALS];
+#endif
+
+/* The set of peripheral sources routed to each CPU interrupt of each CPU.
+ * There is one bit per peripheral laid out like the three DPORT interrupt
+ * status registers.  xtensa_int_decode() uses these masks to examine only
+ * the sources that may have raised the CPU interrupt being decoded.
+ */
+
+#ifdef CONFIG_SMP
+uint32_t
+  g_cpuint_sources[CONFIG_SMP_NCPUS][ESP32_NCPUINTS][ESP32_NSTATUSREGS];
+#else
+uint32_t g_cpuint_sources[1][ESP32_NCPUINTS][ESP32_NSTATUSREGS];
+#endif
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -165,9 +223,21 @@ static uint32_t g_intenable[1];
 
 #endif
 
-/* Bitsets for free, unallocated CPU interrupts */
+/* CPU interrupt allocation state of each CPU.  Each CPU has its own set of
+ * 32 CPU interrupts so allocations are tracked independently.
+ */
 
-static uint32_t g_free_cpuints = 0xffffffff;
+#ifdef CONFIG_SMP
+static struct esp32_intalloc_s g_cpuint_alloc[CONFIG_SMP_NCPUS];
+#else
+static struct esp32_intalloc_s g_cpuint_alloc[1];
+#endif
+
+#ifdef CONFIG_SMP
+/* Set of CPUs that have initialized their interrupt matrix routing */
+
+static volatile uint32_t g_cpuint_online;
+#endif
 
 /* Bitsets for each interrupt priority 1-5 */
 
@@ -180,6 +250,10 @@ static const uint32_t g_priority[5] =
   ESP32_INTPRI5_MASK
 };
 
+/* Current routing of each peripheral interrupt source */
+
+static struct esp32_periphmap_s g_periphmap[ESP32_NPERIPHERALS];
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -191,68 +265,168 @@ static const uint32_t g_priority[5] =
  *   Allocate a CPU interrupt
  *
  * Input Parameters:
+ *   cpu     - The CPU that will own the CPU interrupt
  *   intmask - mask of candidate CPU interrupts.  The CPU interrupt will be
  *             be allocated from free interrupts within this set
+ *   share   - True:  Join a shared CPU interrupt in the set if there is one
+ *             and allocate a free CPU interrupt in shared mode otherwise.
  *
  * Returned Value:
- *   On success, the allocated level-sensitive, CPU interrupt numbr is
- *   returned.  A negated errno is returned on failure.  The only possible
- *   failure is that all level-sensitive CPU interrupts have already been
- *   allocated.
+ *   On success, the allocated CPU interrupt number is returned.  -ENOMEM
+ *   is returned if every CPU interrupt in 'intmask' is already allocated.
  *
  ****************************************************************************/
 
-int esp32_alloc_cpuint(uint32_t intmask)
+static int esp32_alloc_cpuint(int cpu, uint32_t intmask, bool share)
 {
   irqstate_t flags;
-  uint32_t bitmask;
-  uint32_t intset;
-  int cpuint;
-  int ret = -ENOMEM;
-
-  /* Check if there are is CPU interrupts with the requrested properties
-   * available.
-   */
+  int ret;
 
   flags = enter_critical_section();
+  ret   = esp32_intalloc_alloc(&g_cpuint_alloc[cpu], intmask, share);
+  leave_critical_section(flags);
 
-  intset = g_free_cpuints & intmask;
-  if (intset != 0)
+  if (ret < 0)
     {
-      /* Skip over initial unavailable CPU interrupts quickly in groups
-       * of 8 interrupt.
-       */
+      irqerr("ERROR: CPU%d: No %s CPU interrupt available in %08lx\n",
+             cpu, share ? "shareable" : "free", (unsigned long)intmask);
+    }
 
-      for (cpuint = 0, bitmask = 0xff;
-           cpuint <= ESP32_CPUINT_MAX;
-           cpuint += 8, bitmask <<= 8);
+  return ret;
+}
 
-      /* Search for an unallocated CPU interrupt number in the remaining
-       * intset.
-       */
+/****************************************************************************
+ * Name:  esp32_map_regaddr
+ *
+ * Description:
+ *   Return the address of the interrupt matrix map register that routes
+ *   'periphid' to 'cpu'.
+ *
+ ****************************************************************************/
 
-      for (; cpuint <= ESP32_CPUINT_MAX; cpuint++)
-        {
-          /* If the bit corresponding to the CPU interrupt is '1', then
-           * that CPU interrupt is available.
-           */
+static inline uintptr_t esp32_map_regaddr(int cpu, int periphid)
+{
+#ifdef CONFIG_SMP
+  if (cpu != 0)
+    {
+      return DPORT_APP_MAP_REGADDR(periphid);
+    }
+#endif
 
-          bitmask = (1ul << cpuint);
-          if ((intset & bitmask) != 0)
-            {
-              /* Got it! */
+  return DPORT_PRO_MAP_REGADDR(periphid);
+}
 
-              g_free_cpuints &= ~bitmask;
-              ret = cpuint;
-              break;
-            }
+/****************************************************************************
+ * Name:  esp32_route
+ *
+ * Description:
+ *   Route the peripheral 'periphid' to the CPU interrupt 'cpuint' of 'cpu'
+ *   (or to no CPU interrupt if 'cpuint' is NO_CPUINT) and update the source
+ *   masks used by xtensa_int_decode() accordingly.  Must be called with
+ *   interrupts disabled.
+ *
+ ****************************************************************************/
+
+static void esp32_route(int cpu, int periphid, int cpuint)
+{
+  uintptr_t regaddr = esp32_map_regaddr(cpu, periphid);
+  uint32_t bit      = (1ul << (periphid & 31));
+  int regndx        = periphid >> 5;
+  int oldint;
+
+  /* Remove the source from the CPU interrupt it is currently routed to */
+
+  oldint = getreg32(regaddr) & 0x1f;
+  if (oldint != NO_CPUINT)
+    {
+      g_cpuint_sources[cpu][oldint][regndx] &= ~bit;
+    }
+
+  /* Add it to the new CPU interrupt before the route becomes effective */
+
+  if (cpuint != NO_CPUINT)
+    {
+      g_cpuint_sources[cpu][cpuint][regndx] |= bit;
+    }
+
+  putreg32(cpuint, regaddr);
+}
+
+#ifdef CONFIG_SMP
+/****************************************************************************
+ * Name:  esp32_cpuint_class
+ *
+ * Description:
+ *   Return the set of CPU interrupts with the same trigger type and the
+ *   same priority as 'cpuint'.  A peripheral is migrated to a CPU interrupt
+ *   from this set so that it behaves identically on the other CPU.
+ *
+ ****************************************************************************/
+
+static uint32_t esp32_cpuint_class(int cpuint)
+{
+  uint32_t bitmask = (1ul << cpuint);
+  uint32_t intmask;
+  int i;
+
+  intmask = (EPS32_CPUINT_LEVELSET & bitmask) != 0 ?
+            EPS32_CPUINT_LEVELSET : EPS32_CPUINT_EDGESET;
+
+  for (i = 0; i < 5; i++)
+    {
+      if ((g_priority[i] & bitmask) != 0)
+        {
+          return intmask & g_priority[i];
         }
     }
 
-  leave_critical_section(flags);
-  return ret;
+  return 0;
 }
 
+/****************************************************************************
+ * Name:  esp32_irq_migrate
+ *
+ * Description:
+ *   Complete a pending migration of a peripheral interrupt.  This must be
+ *   called on the CPU that currently receives the peripheral interrupt
+ *   with interrupts disabled:  The peripheral interrupt handler then cannot
+ *   be running on the old CPU while the new CPU starts receiving the
+ *   interrupt.
+ *
+ ****************************************************************************/
+
+static void esp32_irq_migrate(int periphid)
+{
+  FAR struct esp32_periphmap_s *map = &g_periphmap[periphid];
+
+  DEBUGASSERT(map->cpu == up_cpu_index());
+
+  /* Stop delivery to the old CPU */
+
+  esp32_route(map->cpu, periphid, NO_CPUINT);
+
+#ifdef CONFIG_ESP32_GPIO_IRQ
+  /* The GPIO peripheral interrupt is special:  Each pin selects the CPU(s)
+   * that it interrupts, so the pin configuration must follow.
+   */
+
+  if (periphid == ESP32_PERIPH_CPU_GPIO)
+    {
+      esp32_gpioirqmigrate(map->newcpu);
+    }
+#endif
+
+  /* Start delivery to the new CPU and release the old CPU interrupt */
+
+  esp32_route(map->newcpu, periphid, map->newint);
+  (void)esp32_intalloc_free(&g_cpuint_alloc[map->cpu], map->cpuint);
+
+  map->cpu    = map->newcpu;
+  map->cpuint = map->newint;
+  map->flags &= ~ESP32_PERIPH_MIGRATE;
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -305,6 +479,122 @@ void up_enable_irq(int cpuint)
 #endif
 }
 
+#ifdef CONFIG_XTENSA_NESTED_INTERRUPTS
+/****************************************************************************
+ * Name: xtensa_irq_level
+ *
+ * Description:
+ *   Return the interrupt level of the CPU interrupt that delivers 'irq'.
+ *   xtensa_irq_dispatch() permits interrupts above this level to preempt
+ *   the handler of 'irq'.  XCHAL_EXCM_LEVEL is returned for IRQs that
+ *   are not delivered by a CPU interrupt (such as the SYSCALL) or that
+ *   are not attached:  Those are never preempted.
+ *
+ ****************************************************************************/
+
+int xtensa_irq_level(int irq)
+{
+  uint32_t bitmask;
+  int cpuint;
+  int i;
+
+  if (irq >= XTENSA_IRQ_FIRSTPERIPH)
+    {
+      /* The peripheral keeps the same level when it is migrated */
+
+      FAR struct esp32_periphmap_s *map =
+        &g_periphmap[ESP32_IRQ2PERIPH(irq)];
+
+      if ((map->flags & ESP32_PERIPH_ATTACHED) == 0)
+        {
+          return XCHAL_EXCM_LEVEL;
+        }
+
+      cpuint = map->cpuint;
+    }
+  else if (irq == XTENSA_IRQ_TIMER0)
+    {
+      cpuint = ESP32_CPUINT_TIMER0;
+    }
+  else if (irq == XTENSA_IRQ_TIMER1)
+    {
+      cpuint = ESP32_CPUINT_TIMER1;
+    }
+  else if (irq == XTENSA_IRQ_TIMER2)
+    {
+      cpuint = ESP32_CPUINT_TIMER2;
+    }
+  else
+    {
+      return XCHAL_EXCM_LEVEL;
+    }
+
+  bitmask = (1ul << cpuint);
+  for (i = 0; i < 5; i++)
+    {
+      if ((g_priority[i] & bitmask) != 0)
+        {
+          return ESP32_MIN_PRIORITY + i;
+        }
+    }
+
+  return XCHAL_EXCM_LEVEL;
+}
+#endif
+
+/****************************************************************************
+ * Name:  esp32_cpuint_initialize
+ *
+ * Description:
+ *   Initialize the interrupt matrix routing for the current CPU.  Every
+ *   peripheral source is detached from this CPU and all CPU interrupts
+ *   that can receive peripheral interrupts are enabled.  From then on,
+ *   peripheral interrupts are gated only by the interrupt matrix:  A CPU
+ *   interrupt with no peripheral attached never fires, and any CPU can
+ *   route a peripheral to this CPU without running code on this CPU.
+ *
+ *   This function must be called once on each CPU, before any peripheral
+ *   is attached to that CPU.
+ *
+ * Input Parameters:
+ *   None
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void esp32_cpuint_initialize(void)
+{
+  int cpu;
+  int i;
+
+#ifdef CONFIG_SMP
+  cpu = up_cpu_index();
+#else
+  cpu = 0;
+#endif
+
+  /* All CPU interrupts that can be attached to peripherals are available */
+
+  esp32_intalloc_init(&g_cpuint_alloc[cpu], ESP32_CPUINT_PERIPHSET);
+
+  /* Detach all peripheral sources from this CPU */
+
+  for (i = 0; i < ESP32_NPERIPHERALS; i++)
+    {
+      esp32_detach_peripheral(cpu, i);
+    }
+
+  /* Enable all CPU interrupts that may be attached to peripherals */
+
+  (void)xtensa_enable_cpuint(&g_intenable[cpu], ESP32_CPUINT_PERIPHSET);
+
+#ifdef CONFIG_SMP
+  g_cpuint_online |= (1 << cpu);
+#endif
+}
+
 /****************************************************************************
  * Name:  esp32_alloc_levelint
  *
@@ -312,6 +602,7 @@ void up_enable_irq(int cpuint)
  *   Allocate a level CPU interrupt
  *
  * Input Parameters:
+ *   cpu      - The CPU that will receive the interrupt 0=PRO CPU 1=APP CPU
  *   priority - Priority of the CPU interrupt (1-5)
  *
  * Returned Value:
@@ -322,19 +613,64 @@ void up_enable_irq(int cpuint)
  *
  ****************************************************************************/
 
-int esp32_alloc_levelint(int priority)
+int esp32_alloc_levelint(int cpu, int priority)
 {
   uint32_t intmask;
 
   DEBUGASSERT(priority >= ESP32_MIN_PRIORITY &&
-              priority <= ESP32_MAX_PRIORITY)
+              priority <= ESP32_MAX_PRIORITY);
+#ifdef CONFIG_SMP
+  DEBUGASSERT(cpu >= 0 && cpu < CONFIG_SMP_NCPUS);
+#else
+  DEBUGASSERT(cpu == 0);
+#endif
 
   /* Check if there are any level CPU interrupts available at the requested
    * interrupt priority.
    */
 
   intmask = g_priority[ESP32_PRIO_INDEX(priority)] & EPS32_CPUINT_LEVELSET;
-  return esp32_alloc_cpuint(intmask);
+  return esp32_alloc_cpuint(cpu, intmask, false);
+}
+
+/****************************************************************************
+ * Name:  esp32_alloc_sharedint
+ *
+ * Description:
+ *   Allocate a level CPU interrupt that may be shared with other
+ *   peripherals.  If a shared level CPU interrupt of the requested priority
+ *   already exists on the CPU, it is reused.
+ *
+ * Input Parameters:
+ *   cpu      - The CPU that will receive the interrupt 0=PRO CPU 1=APP CPU
+ *   priority - Priority of the CPU interrupt (1-5)
+ *
+ * Returned Value:
+ *   On success, the allocated level-sensitive, CPU interrupt numbr is
+ *   returned.  A negated errno is returned on failure.  The only possible
+ *   failure is that all level-sensitive CPU interrupts at this priority are
+ *   allocated and none of them is shared.
+ *
+ ****************************************************************************/
+
+int esp32_alloc_sharedint(int cpu, int priority)
+{
+  uint32_t intmask;
+
+  DEBUGASSERT(priority >= ESP32_MIN_PRIORITY &&
+              priority <= ESP32_MAX_PRIORITY);
+#ifdef CONFIG_SMP
+  DEBUGASSERT(cpu >= 0 && cpu < CONFIG_SMP_NCPUS);
+#else
+  DEBUGASSERT(cpu == 0);
+#endif
+
+  /* Only level interrupts can be shared:  An edge from one peripheral
+   * could be lost while another is being serviced.
+   */
+
+  intmask = g_priority[ESP32_PRIO_INDEX(priority)] & EPS32_CPUINT_LEVELSET;
+  return esp32_alloc_cpuint(cpu, intmask, true);
 }
 
 /****************************************************************************
@@ -344,6 +680,7 @@ int esp32_alloc_levelint(int priority)
  *   Allocate an edge CPU interrupt
  *
  * Input Parameters:
+ *   cpu      - The CPU that will receive the interrupt 0=PRO CPU 1=APP CPU
  *   priority - Priority of the CPU interrupt (1-5)
  *
  * Returned Value:
@@ -354,49 +691,59 @@ int esp32_alloc_levelint(int priority)
  *
  ****************************************************************************/
 
-int esp32_alloc_edgeint(int priority)
+int esp32_alloc_edgeint(int cpu, int priority)
 {
   uint32_t intmask;
 
   DEBUGASSERT(priority >= ESP32_MIN_PRIORITY &&
-              priority <= ESP32_MAX_PRIORITY)
+              priority <= ESP32_MAX_PRIORITY);
+#ifdef CONFIG_SMP
+  DEBUGASSERT(cpu >= 0 && cpu < CONFIG_SMP_NCPUS);
+#else
+  DEBUGASSERT(cpu == 0);
+#endif
 
   /* Check if there are any edge CPU interrupts available at the requested
    * interrupt priority.
    */
 
   intmask = g_priority[ESP32_PRIO_INDEX(priority)] & EPS32_CPUINT_EDGESET;
-  return esp32_alloc_cpuint(intmask);
+  return esp32_alloc_cpuint(cpu, intmask, false);
 }
 
 /****************************************************************************
  * Name:  esp32_free_cpuint
  *
  * Description:
- *   Free a previoulsy allocated CPU interrupt
+ *   Free a previoulsy allocated CPU interrupt.  A shared CPU interrupt is
+ *   freed when its last user releases it.
  *
  * Input Parameters:
- *   The CPU interrupt number to be freed
+ *   cpu    - The CPU that owns the CPU interrupt
+ *   cpuint - The CPU interrupt number to be freed
  *
  * Returned Value:
  *   None
  *
  ****************************************************************************/
 
-void esp32_free_cpuint(int cpuint)
+void esp32_free_cpuint(int cpu, int cpuint)
 {
   irqstate_t flags;
-  uint32_t bitmask;
+  int ret;
 
-  DEBUGASSERT(cpuint >= 0 && cpuint < ESP32_CPUINT_NEDGEPERIPHS);
+  DEBUGASSERT(cpuint >= 0 && cpuint <= ESP32_CPUINT_MAX);
 
-  /* Mark the CPU interrupt as available */
+  /* Mark the CPU interrupt as available (or drop one user of a shared CPU
+   * interrupt).
+   */
 
-  bitmask  = (1ul << cpuint);
   flags = enter_critical_section();
-  DEBUGASSERT((g_free_cpuints & bitmask) == 0);
-  g_free_cpuints |= bitmask;
+  ret   = esp32_intalloc_free(&g_cpuint_alloc[cpu], cpuint);
   leave_critical_section(flags);
+
+  DEBUGASSERT(ret >= 0);
+  UNUSED(ret);
 }
 
 /****************************************************************************
@@ -417,24 +764,23 @@ void esp32_free_cpuint(int cpuint)
 
 void esp32_attach_peripheral(int cpu, int periphid, int cpuint)
 {
-  uintptr_t regaddr;
+  FAR struct esp32_periphmap_s *map;
+  irqstate_t flags;
 
   DEBUGASSERT(periphid >= 0 && periphid < ESP32_NPERIPHERALS);
   DEBUGASSERT(cpuint >= 0 && cpuint <= ESP32_CPUINT_MAX);
 #ifdef CONFIG_SMP
   DEBUGASSERT(cpu >= 0 && cpu < CONFIG_SMP_NCPUS);
-
-  if (cpu != 0)
-    {
-      regaddr = DPORT_APP_MAP_REGADDR(periphid);
-    }
-  else
 #endif
-    {
-      regaddr = DPORT_PRO_MAP_REGADDR(periphid);
-    }
 
-  putreg32(cpuint, regaddr);
+  flags       = enter_critical_section();
+  map         = &g_periphmap[periphid];
+  map->flags  = ESP32_PERIPH_ATTACHED;
+  map->cpu    = cpu;
+  map->cpuint = cpuint;
+
+  esp32_route(cpu, periphid, cpuint);
+  leave_critical_section(flags);
 }
 
 /****************************************************************************
@@ -454,21 +800,364 @@ void esp32_attach_peripheral(int cpu, int periphid, int cpuint)
 
 void esp32_detach_peripheral(int cpu, int periphid)
 {
-  uintptr_t regaddr;
+  FAR struct esp32_periphmap_s *map;
+  irqstate_t flags;
 
   DEBUGASSERT(periphid >= 0 && periphid < ESP32_NPERIPHERALS);
 #ifdef CONFIG_SMP
   DEBUGASSERT(cpu >= 0 && cpu < CONFIG_SMP_NCPUS);
+#endif
 
-  if (cpu != 0)
+  flags = enter_critical_section();
+  map   = &g_periphmap[periphid];
+  if (map->cpu == cpu)
     {
-      regaddr = DPORT_APP_MAP_REGADDR(periphid);
+      map->flags = 0;
+    }
+
+  esp32_route(cpu, periphid, NO_CPUINT);
+  leave_critical_section(flags);
+}
+
+/****************************************************************************
+ * Name:  esp32_setup_irq
+ *
+ * Description:
+ *   Allocate a level-sensitive CPU interrupt on 'cpu' and attach the
+ *   peripheral to it.  Unlike peripherals attached directly with
+ *   esp32_attach_peripheral(), the peripheral interrupt may later be moved
+ *   to another CPU with esp32_irq_setaffinity().  Drivers should then
+ *   not retain the returned CPU interrupt, but should release it with
+ *   esp32_teardown_irq().
+ *
+ * Input Parameters:
+ *   cpu      - The CPU to receive the interrupt 0=PRO CPU 1=APP CPU
+ *   periphid - The peripheral number from irq.h to be attached.
+ *   priority - Priority of the CPU interrupt (1-5)
+ *   flags    - ESP32_CPUINT_FLAG_SHARED:  The CPU interrupt may be shared
+ *              with other peripherals that also set this flag.
+ *
+ * Returned Value:
+ *   On success, the allocated CPU interrupt number is returned.  A
+ *   negated errno is returned on failure.
+ *
+ ****************************************************************************/
+
+int esp32_setup_irq(int cpu, int periphid, int priority, int flags)
+{
+  irqstate_t irqflags;
+  uint8_t mapflags;
+  int cpuint;
+
+  if ((flags & ESP32_CPUINT_FLAG_SHARED) != 0)
+    {
+      cpuint   = esp32_alloc_sharedint(cpu, priority);
+      mapflags = ESP32_PERIPH_MOVABLE | ESP32_PERIPH_SHARED;
     }
   else
+    {
+      cpuint   = esp32_alloc_levelint(cpu, priority);
+      mapflags = ESP32_PERIPH_MOVABLE;
+    }
+
+  if (cpuint >= 0)
+    {
+      irqflags = enter_critical_section();
+      esp32_attach_peripheral(cpu, periphid, cpuint);
+      g_periphmap[periphid].flags |= mapflags;
+      leave_critical_section(irqflags);
+    }
+
+  return cpuint;
+}
+
+/****************************************************************************
+ * Name:  esp32_teardown_irq
+ *
+ * Description:
+ *   Detach a peripheral attached by esp32_setup_irq() from whichever CPU
+ *   currently receives it and release its CPU interrupt.
+ *
+ * Input Parameters:
+ *   periphid - The peripheral number from irq.h to be detached.
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void esp32_teardown_irq(int periphid)
+{
+  FAR struct esp32_periphmap_s *map;
+  irqstate_t flags;
+
+  DEBUGASSERT(periphid >= 0 && periphid < ESP32_NPERIPHERALS);
+
+  flags = enter_critical_section();
+  map   = &g_periphmap[periphid];
+
+  if ((map->flags & ESP32_PERIPH_ATTACHED) != 0)
+    {
+#ifdef CONFIG_SMP
+      /* Abandon any migration that has not yet completed */
+
+      if ((map->flags & ESP32_PERIPH_MIGRATE) != 0)
+        {
+          (void)esp32_intalloc_free(&g_cpuint_alloc[map->newcpu],
+                                    map->newint);
+        }
 #endif
+
+      esp32_route(map->cpu, periphid, NO_CPUINT);
+      (void)esp32_intalloc_free(&g_cpuint_alloc[map->cpu], map->cpuint);
+      map->flags = 0;
+    }
+
+  leave_critical_section(flags);
+}
+
+#ifdef CONFIG_SMP
+/****************************************************************************
+ * Name:  esp32_irq_getaffinity
+ *
+ * Description:
+ *   Return the CPU that currently receives a peripheral interrupt.
+ *
+ * Input Parameters:
+ *   periphid - The peripheral number from irq.h.
+ *
+ * Returned Value:
+ *   The CPU index on success; -ENODEV if the peripheral is not attached.
+ *
+ ****************************************************************************/
+
+int esp32_irq_getaffinity(int periphid)
+{
+  FAR struct esp32_periphmap_s *map;
+
+  DEBUGASSERT(periphid >= 0 && periphid < ESP32_NPERIPHERALS);
+
+  map = &g_periphmap[periphid];
+  if ((map->flags & ESP32_PERIPH_ATTACHED) == 0)
+    {
+      return -ENODEV;
+    }
+
+  return map->cpu;
+}
+
+/****************************************************************************
+ * Name:  esp32_irq_setaffinity
+ *
+ * Description:
+ *   Move a peripheral interrupt attached with esp32_setup_irq() to another
+ *   CPU.  A CPU interrupt of the same type and priority is allocated on the
+ *   new CPU.  The interrupt matrix is then reprogrammed by the CPU that
+ *   currently receives the interrupt:  Immediately if that is the calling
+ *   CPU, otherwise from an inter-CPU interrupt.  In the latter case the
+ *   migration completes asynchronously.
+ *
+ *   This function must not be called from the handler of the peripheral
+ *   being moved.
+ *
+ * Input Parameters:
+ *   periphid - The peripheral number from irq.h.
+ *   cpu      - The CPU that should receive the interrupt.
+ *
+ * Returned Value:
+ *   Zero (OK) on success; a negated errno value on failure:
+ *
+ *   -EINVAL - The peripheral is not attached or may not be moved.
+ *   -EAGAIN - The target CPU is not yet running or a migration of this
+ *             peripheral is already in progress.
+ *   -ENOMEM - No suitable CPU interrupt is available on the target CPU.
+ *
+ ****************************************************************************/
+
+int esp32_irq_setaffinity(int periphid, int cpu)
+{
+  FAR struct esp32_periphmap_s *map;
+  irqstate_t flags;
+  int cpuint;
+  int ret = OK;
+
+  DEBUGASSERT(periphid >= 0 && periphid < ESP32_NPERIPHERALS);
+  DEBUGASSERT(cpu >= 0 && cpu < CONFIG_SMP_NCPUS);
+
+  flags = enter_critical_section();
+  map   = &g_periphmap[periphid];
+
+  if ((map->flags & (ESP32_PERIPH_ATTACHED | ESP32_PERIPH_MOVABLE)) !=
+      (ESP32_PERIPH_ATTACHED | ESP32_PERIPH_MOVABLE))
+    {
+      ret = -EINVAL;
+    }
+  else if ((map->flags & ESP32_PERIPH_MIGRATE) != 0 ||
+           (g_cpuint_online & (1 << cpu)) == 0)
+    {
+      ret = -EAGAIN;
+    }
+  else if (map->cpu != cpu)
+    {
+      /* Reserve a CPU interrupt of the same class on the new CPU */
+
+      cpuint = esp32_alloc_cpuint(cpu, esp32_cpuint_class(map->cpuint),
+                                  (map->flags & ESP32_PERIPH_SHARED) != 0);
+      if (cpuint < 0)
+        {
+          ret = cpuint;
+        }
+      else
+        {
+          map->newcpu = cpu;
+          map->newint = cpuint;
+          map->flags |= ESP32_PERIPH_MIGRATE;
+
+          /* Only the CPU receiving the interrupt can safely reroute it */
+
+          if (map->cpu == up_cpu_index())
+            {
+              esp32_irq_migrate(periphid);
+            }
+          else
+            {
+              ret = xtensa_intercpu_interrupt(map->cpu,
+                                              CPU_INTCODE_IRQMIGRATE);
+              if (ret < 0)
+                {
+                  /* The request could not be sent:  Abandon the migration
+                   * and release the CPU interrupt reserved for it.
+                   */
+
+                  map->flags &= ~ESP32_PERIPH_MIGRATE;
+                  map->newcpu = map->cpu;
+                  map->newint = map->cpuint;
+                  (void)esp32_intalloc_free(&g_cpuint_alloc[cpu], cpuint);
+                }
+            }
+        }
+    }
+
+  leave_critical_section(flags);
+  return ret;
+}
+
+/****************************************************************************
+ * Name:  esp32_irq_migrate_handler
+ *
+ * Description:
+ *   Handler for the CPU_INTCODE_IRQMIGRATE inter-CPU interrupt.  Complete
+ *   every pending migration away from the current CPU.
+ *
+ ****************************************************************************/
+
+void esp32_irq_migrate_handler(void)
+{
+  irqstate_t flags;
+  int cpu;
+  int i;
+
+  flags = enter_critical_section();
+  cpu   = up_cpu_index();
+
+  for (i = 0; i < ESP32_NPERIPHERALS; i++)
+    {
+      if ((g_periphmap[i].flags & ESP32_PERIPH_MIGRATE) != 0 &&
+          g_periphmap[i].cpu == cpu)
+        {
+          esp32_irq_migrate(i);
+        }
+    }
+
+  leave_critical_section(flags);
+}
+#endif /* CONFIG_SMP */
+
+#ifdef CONFIG_ESP32_IRQ_BALANCE
+/****************************************************************************
+ * Name:  esp32_irq_rebalance
+ *
+ * Description:
+ *   Compare the interrupt load of the two CPUs and, if they differ by more
+ *   than CONFIG_ESP32_IRQ_BALANCE_THRESHOLD, move the one movable
+ *   peripheral interrupt from the busier CPU whose migration best evens out
+ *   the load.  The load counts are then halved so that they represent a
+ *   decaying average over the recent rebalance intervals.
+ *
+ *   This is called periodically from the timer interrupt.
+ *
+ ****************************************************************************/
+
+void esp32_irq_rebalance(void)
+{
+  FAR struct esp32_periphmap_s *map;
+  uint32_t load[CONFIG_SMP_NCPUS];
+  uint32_t bestdiff;
+  uint32_t periphload;
+  uint32_t diff;
+  uint32_t newdiff;
+  int busy;
+  int best;
+  int i;
+
+  for (i = 0; i < CONFIG_SMP_NCPUS; i++)
+    {
+      load[i] = 0;
+    }
+
+  for (i = 0; i < ESP32_NPERIPHERALS; i++)
     {
-      regaddr = DPORT_PRO_MAP_REGADDR(periphid);
+      map = &g_periphmap[i];
+      if ((map->flags & ESP32_PERIPH_ATTACHED) != 0)
+        {
+          load[map->cpu] += g_periph_load[i];
+        }
+    }
+
+  busy = load[0] >= load[1] ? 0 : 1;
+  diff = load[busy] - load[busy ^ 1];
+
+  if (diff > CONFIG_ESP32_IRQ_BALANCE_THRESHOLD)
+    {
+      /* Moving a peripheral with load L changes the difference from diff
+       * to |diff - 2L|.  Select the peripheral that minimizes that.
+       */
+
+      best     = -1;
+      bestdiff = diff;
+
+      for (i = 0; i < ESP32_NPERIPHERALS; i++)
+        {
+          map = &g_periphmap[i];
+          if ((map->flags & (ESP32_PERIPH_ATTACHED | ESP32_PERIPH_MOVABLE |
+                             ESP32_PERIPH_MIGRATE)) !=
+              (ESP32_PERIPH_ATTACHED | ESP32_PERIPH_MOVABLE) ||
+              map->cpu != busy)
+            {
+              continue;
+            }
+
+          periphload = g_periph_load[i];
+          newdiff    = 2 * periphload > diff ? 2 * periphload - diff :
+                                               diff - 2 * periphload;
+          if (newdiff < bestdiff)
+            {
+              best     = i;
+              bestdiff = newdiff;
+            }
+        }
+
+      if (best >= 0)
+        {
+          (void)esp32_irq_setaffinity(best, busy ^ 1);
+        }
     }
 
-  putreg32(NO_CPUINT, regaddr);
+  /* Age the load samples */
+
+  for (i = 0; i < ESP32_NPERIPHERALS; i++)
+    {
+      g_periph_load[i] >>= 1;
+    }
 }
+#endif /* CONFIG_ESP32_IRQ_BALANCE */
@@ -42,10 +42,70 @@
 
 #include <nuttx/config.h>
 
+#include <stdint.h>
+
+#include <arch/irq.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Flags for esp32_setup_irq() */
+
+#define ESP32_CPUINT_FLAG_SHARED  (1 << 0) /* CPU interrupt may be shared */
+
+/* Dimensions of the per-CPU interrupt source masks */
+
+#define ESP32_NCPUINTS            (ESP32_CPUINT_MAX + 1)
+#define ESP32_NSTATUSREGS         3 /* DPORT interrupt status registers */
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+#ifdef CONFIG_ESP32_IRQ_BALANCE
+/* Decayed count of interrupts taken from each peripheral.  This is the
+ * load measure used by esp32_irq_rebalance().
+ */
+
+extern volatile uint32_t g_periph_load[ESP32_NPERIPHERALS];
+#endif
+
+/* The set of peripheral sources routed to each CPU interrupt of each CPU,
+ * laid out like the DPORT interrupt status registers.
+ */
+
+#ifdef CONFIG_SMP
+extern uint32_t
+  g_cpuint_sources[CONFIG_SMP_NCPUS][ESP32_NCPUINTS][ESP32_NSTATUSREGS];
+#else
+extern uint32_t g_cpuint_sources[1][ESP32_NCPUINTS][ESP32_NSTATUSREGS];
+#endif
+
 /****************************************************************************
  * Public Function Prototypes
  ****************************************************************************/
 
+/****************************************************************************
+ * Name:  esp32_cpuint_initialize
+ *
+ * Description:
+ *   Initialize the interrupt matrix routing for the current CPU.  Every
+ *   peripheral source is detached from this CPU and all CPU interrupts
+ *   that can receive peripheral interrupts are enabled.  Peripheral
+ *   interrupts are thereafter gated by the interrupt matrix only.  Must be
+ *   called once on each CPU before any peripheral is attached to it.
+ *
+ * Input Parameters:
+ *   None
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void esp32_cpuint_initialize(void);
+
 /****************************************************************************
  * Name:  esp32_alloc_levelint
  *
@@ -53,6 +113,7 @@
  *   Allocate a level CPU interrupt
  *
  * Input Parameters:
+ *   cpu      - The CPU that will receive the interrupt 0=PRO CPU 1=APP CPU
  *   priority - Priority of the CPU interrupt (1-5)
  *
  * Returned Value:
@@ -63,7 +124,7 @@
  *
  ****************************************************************************/
 
-int esp32_alloc_levelint(int priority);
+int esp32_alloc_levelint(int cpu, int priority);
 
 /****************************************************************************
  * Name:  esp32_alloc_edgeint
@@ -72,6 +133,7 @@ int esp32_alloc_levelint(int priority);
  *   Allocate an edge CPU interrupt
  *
  * Input Parameters:
+ *   cpu      - The CPU that will receive the interrupt 0=PRO CPU 1=APP CPU
  *   priority - Priority of the CPU interrupt (1-5)
  *
  * Returned Value:
@@ -82,15 +144,39 @@ int esp32_alloc_levelint(int priority);
  *
  ****************************************************************************/
 
-int esp32_alloc_edgeint(int priority);
+int esp32_alloc_edgeint(int cpu, int priority);
+
+/****************************************************************************
+ * Name:  esp32_alloc_sharedint
+ *
+ * Description:
+ *   Allocate a level CPU interrupt that may be shared with other
+ *   peripherals.  If a shared level CPU interrupt of the requested priority
+ *   already exists on the CPU, it is reused.
+ *
+ * Input Parameters:
+ *   cpu      - The CPU that will receive the interrupt 0=PRO CPU 1=APP CPU
+ *   priority - Priority of the CPU interrupt (1-5)
+ *
+ * Returned Value:
+ *   On success, the allocated level-sensitive, CPU interrupt numbr is
+ *   returned.  A negated errno is returned on failure.  The only possible
+ *   failure is that all level-sensitive CPU interrupts at this priority are
+ *   allocated and none of them is shared.
+ *
+ ****************************************************************************/
+
+int esp32_alloc_sharedint(int cpu, int priority);
 
 /****************************************************************************
  * Name:  esp32_free_cpuint
  *
  * Description:
- *   Free a previoulsy allocated CPU interrupt
+ *   Free a previoulsy allocated CPU interrupt.  A shared CPU interrupt is
+ *   freed when its last user releases it.
  *
  * Input Parameters:
+ *   cpu    - The CPU that owns the CPU interrupt
  *   cpuint - The CPU interrupt number to be freed
  *
  * Returned Value:
@@ -98,7 +184,7 @@ int esp32_alloc_edgeint(int priority);
  *
  ****************************************************************************/
 
-void esp32_free_cpuint(int cpuint);
+void esp32_free_cpuint(int cpu, int cpuint);
 
 /****************************************************************************
  * Name:  esp32_attach_peripheral
@@ -135,4 +221,112 @@ void esp32_attach_peripheral(int cpu, int periphid, int cpuint);
 
 void esp32_detach_peripheral(int cpu, int periphid);
 
+/****************************************************************************
+ * Name:  esp32_setup_irq
+ *
+ * Description:
+ *   Allocate a level-sensitive CPU interrupt on 'cpu' and attach the
+ *   peripheral to it.  The peripheral interrupt may later be moved to
+ *   another CPU with esp32_irq_setaffinity() so the caller should not
+ *   retain the returned CPU interrupt number.
+ *
+ * Input Parameters:
+ *   cpu      - The CPU to receive the interrupt 0=PRO CPU 1=APP CPU
+ *   periphid - The peripheral number from irq.h to be attached.
+ *   priority - Priority of the CPU interrupt (1-5)
+ *   flags    - ESP32_CPUINT_FLAG_SHARED:  The CPU interrupt may be shared
+ *              with other peripherals that also set this flag.
+ *
+ * Returned Value:
+ *   On success, the allocated CPU interrupt number is returned.  A
+ *   negated errno is returned on failure.
+ *
+ ****************************************************************************/
+
+int esp32_setup_irq(int cpu, int periphid, int priority, int flags);
+
+/****************************************************************************
+ * Name:  esp32_teardown_irq
+ *
+ * Description:
+ *   Detach a peripheral attached by esp32_setup_irq() from whichever CPU
+ *   currently receives it and release its CPU interrupt.
+ *
+ * Input Parameters:
+ *   periphid - The peripheral number from irq.h to be detached.
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void esp32_teardown_irq(int periphid);
+
+/****************************************************************************
+ * Name:  esp32_irq_getaffinity
+ *
+ * Description:
+ *   Return the CPU that currently receives a peripheral interrupt.
+ *
+ * Input Parameters:
+ *   periphid - The peripheral number from irq.h.
+ *
+ * Returned Value:
+ *   The CPU index on success; -ENODEV if the peripheral is not attached.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SMP
+int esp32_irq_getaffinity(int periphid);
+#else
+#  define esp32_irq_getaffinity(p) (0)
+#endif
+
+/****************************************************************************
+ * Name:  esp32_irq_setaffinity
+ *
+ * Description:
+ *   Move a peripheral interrupt attached with esp32_setup_irq() to another
+ *   CPU.  If the interrupt is currently received by the other CPU, the
+ *   migration completes asynchronously in an inter-CPU interrupt.
+ *
+ * Input Parameters:
+ *   periphid - The peripheral number from irq.h.
+ *   cpu      - The CPU that should receive the interrupt.
+ *
+ * Returned Value:
+ *   Zero (OK) on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SMP
+int esp32_irq_setaffinity(int periphid, int cpu);
+#endif
+
+/****************************************************************************
+ * Name:  esp32_irq_migrate_handler
+ *
+ * Description:
+ *   Handler for the CPU_INTCODE_IRQMIGRATE inter-CPU interrupt.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SMP
+void esp32_irq_migrate_handler(void);
+#endif
+
+/****************************************************************************
+ * Name:  esp32_irq_rebalance
+ *
+ * Description:
+ *   Move one movable peripheral interrupt from the busier CPU to the less
+ *   busy CPU if their interrupt loads differ by more than
+ *   CONFIG_ESP32_IRQ_BALANCE_THRESHOLD.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_ESP32_IRQ_BALANCE
+void esp32_irq_rebalance(void);
+#endif
+
 #endif /* __ARCH_XTENSA_SRC_ESP32_ESP32_CPUINT_H */
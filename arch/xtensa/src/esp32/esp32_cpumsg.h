@@ -0,0 +1,181 @@
+/****************************************************************************
+ * arch/xtensa/src/esp32/esp32_cpumsg.h
+ *
+ *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __ARCH_XTENSA_SRC_ESP32_ESP32_CPUMSG_H
+#define __ARCH_XTENSA_SRC_ESP32_ESP32_CPUMSG_H 1
+
+/* Inter-CPU message rings.
+ *
+ * There is one ring for each (sending CPU, receiving CPU) pair.  Each ring
+ * has a single producer, the sending CPU with its local interrupts
+ * disabled, and a single consumer, the inter-CPU interrupt handler of the
+ * receiving CPU.  No lock is needed:  'head' is written only by the
+ * producer and 'tail' only by the consumer.  Both are free-running
+ * counters.
+ *
+ * This is pure ring logic with no dependencies on the ESP32 hardware or on
+ * NuttX so that it may also be built and exercised on a host.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Number of messages in each ring.  Must be a power of two. */
+
+#ifndef ESP32_CPUMSG_NSLOTS
+#  define ESP32_CPUMSG_NSLOTS  8
+#endif
+
+#if (ESP32_CPUMSG_NSLOTS & (ESP32_CPUMSG_NSLOTS - 1)) != 0
+#  error ESP32_CPUMSG_NSLOTS must be a power of two
+#endif
+
+/* Orders the accesses to a message slot with the update of 'head' or
+ * 'tail' (MEMW on the Xtensa).
+ */
+
+#define esp32_cpumsg_barrier()  __sync_synchronize()
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* One inter-CPU message.  The meaning of the arguments depends upon the
+ * message code (CPU_INTCODE_* in xtensa.h).
+ */
+
+struct esp32_cpumsg_s
+{
+  uint8_t   code;                             /* Message code */
+  uintptr_t arg[2];                           /* Message arguments */
+};
+
+struct esp32_cpuring_s
+{
+  volatile uint32_t head;                     /* Messages sent */
+  volatile uint32_t tail;                     /* Messages received */
+  struct esp32_cpumsg_s msg[ESP32_CPUMSG_NSLOTS];
+};
+
+/****************************************************************************
+ * Inline Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: esp32_cpuring_init
+ *
+ * Description:
+ *   Initialize an empty ring.
+ *
+ ****************************************************************************/
+
+static inline void esp32_cpuring_init(struct esp32_cpuring_s *ring)
+{
+  ring->head = 0;
+  ring->tail = 0;
+}
+
+/****************************************************************************
+ * Name: esp32_cpuring_put
+ *
+ * Description:
+ *   Producer side:  Append a message to the ring.
+ *
+ * Returned Value:
+ *   true if the message was queued; false if the ring is full.
+ *
+ ****************************************************************************/
+
+static inline bool esp32_cpuring_put(struct esp32_cpuring_s *ring,
+                                     const struct esp32_cpumsg_s *msg)
+{
+  uint32_t head = ring->head;
+
+  if (head - ring->tail >= ESP32_CPUMSG_NSLOTS)
+    {
+      return false;
+    }
+
+  ring->msg[head & (ESP32_CPUMSG_NSLOTS - 1)] = *msg;
+
+  /* Publish the message only after it has been completely written */
+
+  esp32_cpumsg_barrier();
+  ring->head = head + 1;
+  return true;
+}
+
+/****************************************************************************
+ * Name: esp32_cpuring_get
+ *
+ * Description:
+ *   Consumer side:  Remove the oldest message from the ring.
+ *
+ * Returned Value:
+ *   true if a message was returned in 'msg'; false if the ring is empty.
+ *
+ ****************************************************************************/
+
+static inline bool esp32_cpuring_get(struct esp32_cpuring_s *ring,
+                                     struct esp32_cpumsg_s *msg)
+{
+  uint32_t tail = ring->tail;
+
+  if (tail == ring->head)
+    {
+      return false;
+    }
+
+  /* Read the message only after 'head' has shown that it is complete and
+   * release the slot only after it has been read.
+   */
+
+  esp32_cpumsg_barrier();
+  *msg = ring->msg[tail & (ESP32_CPUMSG_NSLOTS - 1)];
+  esp32_cpumsg_barrier();
+
+  ring->tail = tail + 1;
+  return true;
+}
+
+#endif /* __ARCH_XTENSA_SRC_ESP32_ESP32_CPUMSG_H */
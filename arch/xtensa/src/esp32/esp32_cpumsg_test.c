@@ -0,0 +1,220 @@
+/****************************************************************************
+ * arch/xtensa/src/esp32/esp32_cpumsg_test.c
+ *
+ *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/* Host stress test for the inter-CPU message rings of esp32_cpumsg.h.
+ *
+ * Two threads stand in for the two CPUs.  Each sends a numbered stream of
+ * messages to the other through its own ring and receives the other's
+ * stream, as esp32_fromcpu_interrupt() does, while it waits for room.  The
+ * receiver checks that every message arrives exactly once, in order and
+ * intact.  The ring counters start just below the 32-bit wrap.
+ *
+ * This is not part of the NuttX build.  Build and run it on the host with:
+ *
+ *   gcc -O2 -Wall -pthread -o cpumsg_test \
+ *     arch/xtensa/src/esp32/esp32_cpumsg_test.c
+ *   ./cpumsg_test [nmessages]
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "esp32_cpumsg.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define NCPUS              2
+#define DEFAULT_NMESSAGES  2000000
+#define RING_START         (UINT32_MAX - 100)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct cpu_s
+{
+  int      cpu;                 /* This "CPU" */
+  uint32_t nmessages;           /* Messages to send */
+  uint32_t sent;                /* Messages sent */
+  uint32_t received;            /* Messages received */
+  uint32_t fullwaits;           /* Times that the ring was found full */
+  uint32_t errors;              /* Messages lost, repeated or corrupted */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct esp32_cpuring_s g_cpuring[NCPUS][NCPUS];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void cpumsg_receive(struct cpu_s *me)
+{
+  struct esp32_cpuring_s *ring = &g_cpuring[1 - me->cpu][me->cpu];
+  struct esp32_cpumsg_s msg;
+  uint32_t seq;
+
+  while (esp32_cpuring_get(ring, &msg))
+    {
+      seq = me->received++;
+      if (msg.code != (uint8_t)seq || msg.arg[0] != (uintptr_t)seq ||
+          msg.arg[1] != ~(uintptr_t)seq)
+        {
+          if (me->errors++ < 10)
+            {
+              fprintf(stderr, "CPU%d: expected %lu, got %lu/%lx/%u\n",
+                      me->cpu, (unsigned long)seq,
+                      (unsigned long)msg.arg[0],
+                      (unsigned long)~msg.arg[1], msg.code);
+            }
+
+          me->received = (uint32_t)msg.arg[0] + 1;
+        }
+    }
+}
+
+static void *cpumsg_thread(void *arg)
+{
+  struct cpu_s *me = (struct cpu_s *)arg;
+  struct esp32_cpuring_s *ring = &g_cpuring[me->cpu][1 - me->cpu];
+  struct esp32_cpumsg_s msg;
+
+  while (me->sent < me->nmessages || me->received < me->nmessages)
+    {
+      if (me->sent < me->nmessages)
+        {
+          msg.code   = (uint8_t)me->sent;
+          msg.arg[0] = (uintptr_t)me->sent;
+          msg.arg[1] = ~(uintptr_t)me->sent;
+
+          if (esp32_cpuring_put(ring, &msg))
+            {
+              me->sent++;
+            }
+          else
+            {
+              /* Let the other thread run if there is only one host CPU */
+
+              me->fullwaits++;
+              sched_yield();
+            }
+        }
+
+      cpumsg_receive(me);
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, char **argv)
+{
+  struct cpu_s cpus[NCPUS];
+  pthread_t threads[NCPUS];
+  uint32_t nmessages = DEFAULT_NMESSAGES;
+  int ret = EXIT_SUCCESS;
+  int i;
+  int j;
+
+  if (argc > 1)
+    {
+      nmessages = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+
+  for (i = 0; i < NCPUS; i++)
+    {
+      for (j = 0; j < NCPUS; j++)
+        {
+          esp32_cpuring_init(&g_cpuring[i][j]);
+          g_cpuring[i][j].head = RING_START;
+          g_cpuring[i][j].tail = RING_START;
+        }
+    }
+
+  for (i = 0; i < NCPUS; i++)
+    {
+      cpus[i].cpu       = i;
+      cpus[i].nmessages = nmessages;
+      cpus[i].sent      = 0;
+      cpus[i].received  = 0;
+      cpus[i].fullwaits = 0;
+      cpus[i].errors    = 0;
+
+      if (pthread_create(&threads[i], NULL, cpumsg_thread, &cpus[i]) != 0)
+        {
+          perror("pthread_create");
+          return EXIT_FAILURE;
+        }
+    }
+
+  for (i = 0; i < NCPUS; i++)
+    {
+      pthread_join(threads[i], NULL);
+    }
+
+  for (i = 0; i < NCPUS; i++)
+    {
+      printf("CPU%d: sent %lu received %lu ring full %lu errors %lu\n",
+             i, (unsigned long)cpus[i].sent,
+             (unsigned long)cpus[i].received,
+             (unsigned long)cpus[i].fullwaits,
+             (unsigned long)cpus[i].errors);
+
+      if (cpus[i].errors != 0 || cpus[i].received != nmessages)
+        {
+          ret = EXIT_FAILURE;
+        }
+    }
+
+  printf("%s\n", ret == EXIT_SUCCESS ? "PASSED" : "FAILED");
+  return ret;
+}
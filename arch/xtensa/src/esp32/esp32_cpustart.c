@@ -112,7 +112,7 @@ static inline void xtensa_attach_fromcpu0_interrupt(void)
 
   /* Allocate a level-sensitive, priority 1 CPU interrupt for the UART */
 
-  cpuint = esp32_alloc_levelint(1);
+  cpuint = esp32_alloc_levelint(1, 1);
   DEBUGASSERT(cpuint >= 0);
 
   /* Connect all CPU peripheral source to allocated CPU interrupt */
@@ -153,7 +153,12 @@ static inline void xtensa_attach_fromcpu0_interrupt(void)
 int xtensa_start_handler(int irq, FAR void *context)
 {
   FAR struct tcb_s *tcb;
-  int i;
+
+  /* Locate the per-CPU data of this CPU before anything can reference
+   * CURRENT_REGS.
+   */
+
+  xtensa_percpu_initialize(1);
 
   sinfo("CPU%d Started\n", up_cpu_index());
 
@@ -179,6 +184,12 @@ int xtensa_start_handler(int irq, FAR void *context)
 
   xtensa_disable_all();
 
+  /* Detach all peripheral sources APP CPU interrupts and enable the CPU
+   * interrupts that peripherals may be routed to.
+   */
+
+  esp32_cpuint_initialize();
+
   /* Attach and emable internal interrupts */
 
 #ifdef CONFIG_SMP
@@ -187,13 +198,6 @@ int xtensa_start_handler(int irq, FAR void *context)
   xtensa_attach_fromcpu0_interrupt();
 #endif
 
-  /* Detach all peripheral sources APP CPU interrupts */
-
-  for (i = 0; i < ESP32_NPERIPHERALS; i++)
-    {
-      esp32_detach_peripheral(1, i);;
-    }
-
 #if 0 /* Does it make since to have co-processors enabled on the IDLE thread? */
 #if XTENSA_CP_ALLSET != 0
   /* Set initial co-processor state */
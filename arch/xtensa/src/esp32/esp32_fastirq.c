@@ -0,0 +1,285 @@
+/****************************************************************************
+ * arch/xtensa/src/esp32/esp32_fastirq.c
+ *
+ *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <nuttx/irq.h>
+#include <arch/irq.h>
+
+#include "chip/esp32_dport.h"
+#include "xtensa.h"
+#include "esp32_cpuint.h"
+#include "esp32_fastirq.h"
+
+#ifdef CONFIG_XTENSA_FASTIRQ
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The worker of each CPU is run from the CPU2 (PRO CPU) or CPU3 (APP CPU)
+ * software peripheral interrupt.  Writing 1 to the "from CPU" register
+ * raises the interrupt.
+ */
+
+#define ESP32_FASTIRQ_PERIPH(cpu)   (ESP32_PERIPH_CPU_CPU2 + (cpu))
+#define ESP32_FASTIRQ_IRQ(cpu)      (ESP32_IRQ_CPU_CPU2 + (cpu))
+#define ESP32_FASTIRQ_KICKREG(cpu) \
+  ((cpu) == 0 ? DPORT_CPU_INTR_FROM_CPU_2_REG : DPORT_CPU_INTR_FROM_CPU_3_REG)
+
+/* Level 6 is the debug level.  Only levels 4 and 5 are available. */
+
+#define ESP32_FASTIRQ_MAXLEVEL      (XCHAL_DEBUGLEVEL - 1)
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+/* Fast interrupt state of each CPU and level.  Accessed by the level 4
+ * and 5 interrupt handlers.
+ */
+
+#ifdef CONFIG_SMP
+struct xtensa_fastirq_s g_fastirq[CONFIG_SMP_NCPUS][XTENSA_FASTIRQ_NLEVELS];
+#else
+struct xtensa_fastirq_s g_fastirq[1][XTENSA_FASTIRQ_NLEVELS];
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* The peripheral attached to each fast interrupt */
+
+#ifdef CONFIG_SMP
+static uint8_t g_fastirq_periph[CONFIG_SMP_NCPUS][XTENSA_FASTIRQ_NLEVELS];
+#else
+static uint8_t g_fastirq_periph[1][XTENSA_FASTIRQ_NLEVELS];
+#endif
+
+/* True if the worker interrupt of the CPU has been set up */
+
+#ifdef CONFIG_SMP
+static bool g_fastirq_worker[CONFIG_SMP_NCPUS];
+#else
+static bool g_fastirq_worker[1];
+#endif
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name:  esp32_fastirq_interrupt
+ *
+ * Description:
+ *   Worker interrupt:  Pass the work queued by the fast interrupt handlers
+ *   of one CPU to their workers.
+ *
+ ****************************************************************************/
+
+static int esp32_fastirq_interrupt(int irq, FAR void *context)
+{
+  FAR struct xtensa_fastirq_s *firq;
+  int cpu = irq - ESP32_FASTIRQ_IRQ(0);
+  int i;
+
+  /* Acknowledge the request first so that work queued from now on raises
+   * the interrupt again.
+   */
+
+  putreg32(0, ESP32_FASTIRQ_KICKREG(cpu));
+
+  for (i = 0; i < XTENSA_FASTIRQ_NLEVELS; i++)
+    {
+      firq = &g_fastirq[cpu][i];
+      if (firq->worker != NULL)
+        {
+          xtensa_fastirq_drain(firq);
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name:  esp32_fastirq_workerinit
+ *
+ * Description:
+ *   Set up the worker interrupt of 'cpu' if not already done.  Must be
+ *   called within a critical section.
+ *
+ ****************************************************************************/
+
+static int esp32_fastirq_workerinit(int cpu)
+{
+  int cpuint;
+
+  if (!g_fastirq_worker[cpu])
+    {
+      cpuint = esp32_alloc_levelint(cpu, 1);
+      if (cpuint < 0)
+        {
+          return cpuint;
+        }
+
+      (void)irq_attach(ESP32_FASTIRQ_IRQ(cpu),
+                       (xcpt_t)esp32_fastirq_interrupt);
+      esp32_attach_peripheral(cpu, ESP32_FASTIRQ_PERIPH(cpu), cpuint);
+      g_fastirq_worker[cpu] = true;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name:  esp32_fastirq_attach
+ *
+ * Description:
+ *   Route a peripheral to a level 4 or 5 CPU interrupt of 'cpu' that is
+ *   handled by a fast interrupt handler.
+ *
+ ****************************************************************************/
+
+int esp32_fastirq_attach(int cpu, int periphid, int level,
+                         xtensa_fasthandler_t handler,
+                         xtensa_fastwork_t worker, FAR void *arg)
+{
+  FAR struct xtensa_fastirq_s *firq;
+  irqstate_t flags;
+  int ndx;
+  int ret;
+
+#ifdef CONFIG_SMP
+  if (cpu < 0 || cpu >= CONFIG_SMP_NCPUS ||
+#else
+  if (cpu != 0 ||
+#endif
+      periphid < 0 || periphid >= ESP32_NPERIPHERALS ||
+      level < XTENSA_FASTIRQ_MINLEVEL || level > ESP32_FASTIRQ_MAXLEVEL ||
+      handler == NULL)
+    {
+      return -EINVAL;
+    }
+
+  ndx  = level - XTENSA_FASTIRQ_MINLEVEL;
+  firq = &g_fastirq[cpu][ndx];
+
+  flags = enter_critical_section();
+  if (firq->handler != NULL)
+    {
+      ret = -EBUSY;
+      goto errout_with_lock;
+    }
+
+  ret = esp32_fastirq_workerinit(cpu);
+  if (ret < 0)
+    {
+      goto errout_with_lock;
+    }
+
+  ret = esp32_alloc_levelint(cpu, level);
+  if (ret < 0)
+    {
+      goto errout_with_lock;
+    }
+
+  /* Set up the fast interrupt state before the peripheral is routed */
+
+  firq->arg     = arg;
+  firq->intmask = (1ul << ret);
+  firq->kick    = ESP32_FASTIRQ_KICKREG(cpu);
+  firq->head    = 0;
+  firq->tail    = 0;
+  firq->dropped = 0;
+  firq->worker  = worker;
+  firq->handler = handler;
+
+  g_fastirq_periph[cpu][ndx] = periphid;
+  esp32_attach_peripheral(cpu, periphid, ret);
+
+errout_with_lock:
+  leave_critical_section(flags);
+  return ret;
+}
+
+/****************************************************************************
+ * Name:  esp32_fastirq_detach
+ *
+ * Description:
+ *   Detach the fast interrupt handler of 'level' on 'cpu' and release its
+ *   CPU interrupt.
+ *
+ ****************************************************************************/
+
+void esp32_fastirq_detach(int cpu, int level)
+{
+  FAR struct xtensa_fastirq_s *firq;
+  irqstate_t flags;
+  int ndx;
+
+  DEBUGASSERT(level >= XTENSA_FASTIRQ_MINLEVEL &&
+              level <= ESP32_FASTIRQ_MAXLEVEL);
+
+  ndx  = level - XTENSA_FASTIRQ_MINLEVEL;
+  firq = &g_fastirq[cpu][ndx];
+
+  flags = enter_critical_section();
+  if (firq->handler != NULL)
+    {
+      esp32_detach_peripheral(cpu, g_fastirq_periph[cpu][ndx]);
+      esp32_free_cpuint(cpu, __builtin_ctz(firq->intmask));
+
+      firq->worker  = NULL;
+      firq->handler = NULL;
+    }
+
+  leave_critical_section(flags);
+}
+
+#endif /* CONFIG_XTENSA_FASTIRQ */
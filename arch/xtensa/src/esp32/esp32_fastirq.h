@@ -0,0 +1,104 @@
+/****************************************************************************
+ * arch/xtensa/src/esp32/esp32_fastirq.h
+ *
+ *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __ARCH_XTENSA_SRC_ESP32_ESP32_FASTIRQ_H
+#define __ARCH_XTENSA_SRC_ESP32_ESP32_FASTIRQ_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include "xtensa_fastirq.h"
+
+#ifdef CONFIG_XTENSA_FASTIRQ
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name:  esp32_fastirq_attach
+ *
+ * Description:
+ *   Route a peripheral to a level 4 or 5 CPU interrupt of 'cpu' that is
+ *   handled by a fast interrupt handler.  The fast interrupt handler runs
+ *   directly from the interrupt vector without any OS involvement (see
+ *   fastirq_dispatch in xtensa_fastirq.h).  Words that it queues with
+ *   fastirq_post are passed to 'worker' from a priority 1 interrupt on
+ *   the same CPU.
+ *
+ * Input Parameters:
+ *   cpu      - The CPU to receive the interrupt 0=PRO CPU 1=APP CPU
+ *   periphid - The peripheral number from irq.h to be attached.
+ *   level    - The interrupt level:  4 or 5
+ *   handler  - The fast interrupt handler (assembly language, in IRAM)
+ *   worker   - Receives the queued words.  May be NULL if the handler
+ *              does not queue any work.
+ *   arg      - Argument available to the handler and passed to the worker
+ *
+ * Returned Value:
+ *   The allocated CPU interrupt on success; a negated errno value on
+ *   failure:  -EINVAL if an argument is invalid, -EBUSY if 'level' already
+ *   has a fast interrupt handler on 'cpu' or -ENOMEM if there is no free
+ *   CPU interrupt at 'level'.
+ *
+ ****************************************************************************/
+
+int esp32_fastirq_attach(int cpu, int periphid, int level,
+                         xtensa_fasthandler_t handler,
+                         xtensa_fastwork_t worker, FAR void *arg);
+
+/****************************************************************************
+ * Name:  esp32_fastirq_detach
+ *
+ * Description:
+ *   Detach the fast interrupt handler of 'level' on 'cpu' and release its
+ *   CPU interrupt.  Work still queued is discarded.
+ *
+ * Input Parameters:
+ *   cpu      - The CPU that receives the interrupt 0=PRO CPU 1=APP CPU
+ *   level    - The interrupt level:  4 or 5
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void esp32_fastirq_detach(int cpu, int level);
+
+#endif /* CONFIG_XTENSA_FASTIRQ */
+#endif /* __ARCH_XTENSA_SRC_ESP32_ESP32_FASTIRQ_H */
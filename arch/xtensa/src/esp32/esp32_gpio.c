@@ -52,12 +52,25 @@
 #define NGPIO_HMASK  ((1ul << NGPIO_HPINS) - 1)
 #define _NA_         0xff
 
+/* GPIO_PIN_INT_ENA bits that route a pin interrupt to each CPU:
+ *
+ *   Bit 0: APP CPU interrupt enable
+ *   Bit 1: APP CPU non-maskable interrupt enable
+ *   Bit 2: PRO CPU interrupt enable
+ *   Bit 3: PRO CPU non-maskable interrupt enable
+ *   Bit 4: SDIO's extent interrupt enable.
+ */
+
+#define GPIO_INTENA_PRO    ((1 << 2) << GPIO_PIN_INT_ENA_S)
+#define GPIO_INTENA_APP    ((1 << 0) << GPIO_PIN_INT_ENA_S)
+#define GPIO_INTENA(cpu)   ((cpu) == 0 ? GPIO_INTENA_PRO : GPIO_INTENA_APP)
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
 
 #ifdef CONFIG_ESP32_GPIO_IRQ
-static uint8_t g_gpio_cpuint;
+static uint8_t g_gpio_cpu;   /* CPU currently receiving GPIO interrupts */
 #endif
 
 static const uint8_t g_pin2func[40] =
@@ -314,30 +327,24 @@ bool esp32_gpioread(int pin)
 #ifdef CONFIG_ESP32_GPIO_IRQ
 void esp32_gpioirqinitialize(void)
 {
-  int cpu;
-
-  /* Allocate a level-sensitive, priority 1 CPU interrupt */
-
-  g_gpio_cpuint = esp32_alloc_levelint(1);
-  DEBUGASSERT(g_gpio_cpuint >= 0);
-
   /* Set up to receive peripheral interrupts on the current CPU */
 
 #ifdef CONFIG_SMP
-  cpu = up_cpu_index();
+  g_gpio_cpu = up_cpu_index();
 #else
-  cpu = 0;
+  g_gpio_cpu = 0;
 #endif
 
-  /* Attach the GPIO peripheral to the allocated CPU interrupt */
+  /* Attach the interrupt handler */
 
-  up_disable_irq(g_gpio_cpuint);
-  esp32_attach_peripheral(cpu, ESP32_PERIPH_CPU_GPIO, g_gpio_cpuint);
+  DEBUGVERIFY(irq_attach(ESP32_IRQ_CPU_GPIO, gpio_interrupt));
 
-  /* Attach and enable the interrupt handler */
+  /* Attach the GPIO peripheral to a level-sensitive, priority 1 CPU
+   * interrupt.  The GPIO interrupt may later be moved to the other CPU
+   * with esp32_irq_setaffinity().
+   */
 
-  DEBUGVERIFY(irq_attach(ESP32_IRQ_CPU_GPIO, gpio_interrupt));
-  up_enable_irq(g_gpio_cpuint);
+  DEBUGVERIFY(esp32_setup_irq(g_gpio_cpu, ESP32_PERIPH_CPU_GPIO, 1, 0) >= 0);
 }
 #endif
 
@@ -352,9 +359,9 @@ void esp32_gpioirqinitialize(void)
 #ifdef CONFIG_ESP32_GPIO_IRQ
 void esp32_gpioirqenable(int irq, gpio_intrtype_t intrtype)
 {
+  irqstate_t flags;
   uintptr_t regaddr;
   uint32_t regval;
-  int cpu;
   int pin;
 
   DEBUGASSERT(irq <= ESP32_FIRST_GPIOIRQ && irq <= ESP32_LAST_GPIOIRQ);
@@ -363,41 +370,25 @@ void esp32_gpioirqenable(int irq, gpio_intrtype_t intrtype)
 
   pin = ESP32_IRQ2PIN(irq);
 
-  /* Get the address of the GPIO PIN register for this pin */
+  /* Get the address of the GPIO PIN register for this pin.  The GPIO
+   * interrupt may be received by the other CPU, so a critical section
+   * rather than the local CPU interrupt protects this read-modify-write
+   * against esp32_gpioirqmigrate().
+   */
 
-  up_disable_irq(g_gpio_cpuint);
+  flags = enter_critical_section();
 
   regaddr = GPIO_REG(pin);
   regval  = getreg32(regaddr);
   regval &= ~(GPIO_PIN_INT_ENA_M | GPIO_PIN_INT_TYPE_M);
 
-  /* Set the pin ENA field:
-   *
-   *   Bit 0: APP CPU interrupt enable
-   *   Bit 1: APP CPU non-maskable interrupt enable
-   *   Bit 3: PRO CPU interrupt enable
-   *   Bit 4: PRO CPU non-maskable interrupt enable
-   *   Bit 5: SDIO's extent interrupt enable.
-   */
-
-  cpu = up_cpu_index();
-  if (cpu == 0)
-    {
-      /* PRO_CPU */
-
-      regval |= ((1 << 2) << GPIO_PIN_INT_ENA_S);
-    }
-  else
-    {
-      /* APP_CPU */
-
-      regval |= ((1 << 0) << GPIO_PIN_INT_ENA_S);
-    }
+  /* Route the pin interrupt to the CPU that receives GPIO interrupts */
 
+  regval |= GPIO_INTENA(g_gpio_cpu);
   regval |= (intrtype << GPIO_PIN_INT_TYPE_S);
   putreg32(regval, regaddr);
 
-  up_enable_irq(g_gpio_cpuint);
+  leave_critical_section(flags);
 }
 #endif
 
@@ -412,6 +403,7 @@ void esp32_gpioirqenable(int irq, gpio_intrtype_t intrtype)
 #ifdef CONFIG_ESP32_GPIO_IRQ
 void esp32_gpioirqdisable(int irq)
 {
+  irqstate_t flags;
   uintptr_t regaddr;
   uint32_t regval;
   int pin;
@@ -424,13 +416,48 @@ void esp32_gpioirqdisable(int irq)
 
   /* Get the address of the GPIO PIN register for this pin */
 
-  up_disable_irq(g_gpio_cpuint);
+  flags = enter_critical_section();
 
   regaddr = GPIO_REG(pin);
   regval  = getreg32(regaddr);
   regval &= ~(GPIO_PIN_INT_ENA_M | GPIO_PIN_INT_TYPE_M);
   putreg32(regval, regaddr);
 
-  up_enable_irq(g_gpio_cpuint);
+  leave_critical_section(flags);
+}
+#endif
+
+/****************************************************************************
+ * Name: esp32_gpioirqmigrate
+ *
+ * Description:
+ *   Route all enabled GPIO pin interrupts to 'cpu'.  Called by the
+ *   interrupt affinity logic, with interrupts disabled, when the GPIO
+ *   peripheral interrupt is moved to another CPU.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_ESP32_GPIO_IRQ
+void esp32_gpioirqmigrate(int cpu)
+{
+  uintptr_t regaddr;
+  uint32_t oldena;
+  uint32_t regval;
+  int pin;
+
+  oldena = GPIO_INTENA(g_gpio_cpu);
+  for (pin = 0; pin < ESP32_NIRQ_GPIO; pin++)
+    {
+      regaddr = GPIO_REG(pin);
+      regval  = getreg32(regaddr);
+      if ((regval & oldena) != 0)
+        {
+          regval &= ~oldena;
+          regval |= GPIO_INTENA(cpu);
+          putreg32(regval, regaddr);
+        }
+    }
+
+  g_gpio_cpu = cpu;
 }
 #endif
@@ -199,6 +199,19 @@ void esp32_gpioirqdisable(int irq);
 #  define esp32_gpioirqdisable(irq)
 #endif
 
+/****************************************************************************
+ * Name: esp32_gpioirqmigrate
+ *
+ * Description:
+ *   Route all enabled GPIO pin interrupts to 'cpu'.  Used only by the
+ *   interrupt affinity logic when the GPIO interrupt changes CPU.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_ESP32_GPIO_IRQ
+void esp32_gpioirqmigrate(int cpu);
+#endif
+
 int digitalRead(uint8_t pin);
 
 void attachInterrupt(uint8_t pin, void (*)(void), int mode);
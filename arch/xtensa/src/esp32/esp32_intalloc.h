@@ -0,0 +1,218 @@
+/****************************************************************************
+ * arch/xtensa/src/esp32/esp32_intalloc.h
+ *
+ *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __ARCH_XTENSA_SRC_ESP32_ESP32_INTALLOC_H
+#define __ARCH_XTENSA_SRC_ESP32_ESP32_INTALLOC_H 1
+
+/* CPU interrupt allocation bitmaps.
+ *
+ * This is the bookkeeping used by esp32_cpuint.c to allocate the CPU
+ * interrupts of one CPU.  It is pure bitmap logic with no dependencies on
+ * the ESP32 hardware or on NuttX so that it may also be built and exercised
+ * on a host.
+ *
+ * A CPU interrupt is in one of three states:
+ *
+ *   Free      - The bit is set in 'free'.
+ *   Dedicated - Allocated to a single peripheral.
+ *   Shared    - The bit is set in 'shared'.  The interrupt is allocated to
+ *               nshared[cpuint] peripherals whose interrupts are chained.
+ *
+ * All searches are a single count-trailing-zeroes over the intersection of
+ * a state bitmap with the caller's candidate mask (normally the level or
+ * edge set ANDed with one priority mask).
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define ESP32_INTALLOC_NINTS  32
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+struct esp32_intalloc_s
+{
+  uint32_t free;                            /* Unallocated CPU interrupts */
+  uint32_t shared;                          /* Shared CPU interrupts */
+  uint8_t  nshared[ESP32_INTALLOC_NINTS];   /* Users of each shared CPU int */
+};
+
+/****************************************************************************
+ * Inline Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: esp32_intalloc_init
+ *
+ * Description:
+ *   Initialize the allocator.  'avail' is the set of CPU interrupts that
+ *   may be allocated.
+ *
+ ****************************************************************************/
+
+static inline void esp32_intalloc_init(struct esp32_intalloc_s *alloc,
+                                       uint32_t avail)
+{
+  int i;
+
+  alloc->free   = avail;
+  alloc->shared = 0;
+
+  for (i = 0; i < ESP32_INTALLOC_NINTS; i++)
+    {
+      alloc->nshared[i] = 0;
+    }
+}
+
+/****************************************************************************
+ * Name: esp32_intalloc_alloc
+ *
+ * Description:
+ *   Allocate a CPU interrupt from 'intmask'.  If 'share' is true, the
+ *   lowest numbered shared CPU interrupt in 'intmask' is joined if there
+ *   is one; otherwise a free CPU interrupt is taken (and marked shared
+ *   when 'share' is true).
+ *
+ * Returned Value:
+ *   The CPU interrupt number on success, or -ENOMEM if every CPU interrupt
+ *   in 'intmask' is already allocated (and, for a shared request, none of
+ *   them is shared).
+ *
+ ****************************************************************************/
+
+static inline int esp32_intalloc_alloc(struct esp32_intalloc_s *alloc,
+                                       uint32_t intmask, bool share)
+{
+  uint32_t intset;
+  int cpuint;
+
+  if (share)
+    {
+      intset = alloc->shared & intmask;
+      if (intset != 0)
+        {
+          cpuint = __builtin_ctz(intset);
+          alloc->nshared[cpuint]++;
+          return cpuint;
+        }
+    }
+
+  intset = alloc->free & intmask;
+  if (intset == 0)
+    {
+      return -ENOMEM;
+    }
+
+  cpuint       = __builtin_ctz(intset);
+  alloc->free &= ~(1ul << cpuint);
+
+  if (share)
+    {
+      alloc->shared         |= (1ul << cpuint);
+      alloc->nshared[cpuint] = 1;
+    }
+
+  return cpuint;
+}
+
+/****************************************************************************
+ * Name: esp32_intalloc_free
+ *
+ * Description:
+ *   Release one user of a CPU interrupt.  A shared CPU interrupt becomes
+ *   free when its last user releases it.
+ *
+ * Returned Value:
+ *   The number of remaining users of the CPU interrupt (zero if it is now
+ *   free), or -EINVAL if the CPU interrupt was not allocated.
+ *
+ ****************************************************************************/
+
+static inline int esp32_intalloc_free(struct esp32_intalloc_s *alloc,
+                                      int cpuint)
+{
+  uint32_t bitmask;
+
+  if (cpuint < 0 || cpuint >= ESP32_INTALLOC_NINTS)
+    {
+      return -EINVAL;
+    }
+
+  bitmask = (1ul << cpuint);
+  if ((alloc->free & bitmask) != 0)
+    {
+      return -EINVAL;
+    }
+
+  if ((alloc->shared & bitmask) != 0)
+    {
+      if (--alloc->nshared[cpuint] > 0)
+        {
+          return alloc->nshared[cpuint];
+        }
+
+      alloc->shared &= ~bitmask;
+    }
+
+  alloc->free |= bitmask;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: esp32_intalloc_isshared
+ *
+ * Description:
+ *   Return true if the CPU interrupt is allocated in shared mode.
+ *
+ ****************************************************************************/
+
+static inline bool
+esp32_intalloc_isshared(const struct esp32_intalloc_s *alloc, int cpuint)
+{
+  return (alloc->shared & (1ul << cpuint)) != 0;
+}
+
+#endif /* __ARCH_XTENSA_SRC_ESP32_ESP32_INTALLOC_H */
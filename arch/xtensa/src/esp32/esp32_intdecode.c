@@ -44,24 +44,7 @@
 
 #include "chip/esp32_dport.h"
 #include "xtensa.h"
-
-/****************************************************************************
- * Private Data
- ****************************************************************************/
-
-static const uint8_t g_baseirq[3] =
-{
-  ESP32_IRQ_SREG0,
-  ESP32_IRQ_SREG1,
-  ESP32_IRQ_SREG2
-};
-
-static const uint8_t g_nirqs[3] =
-{
-  ESP32_NIRQS_SREG0,
-  ESP32_NIRQS_SREG1,
-  ESP32_NIRQS_SREG2
-};
+#include "esp32_cpuint.h"
 
 /****************************************************************************
  * Public Functions
@@ -71,11 +54,16 @@ static const uint8_t g_nirqs[3] =
  * Name: xtensa_int_decode
  *
  * Description:
- *   Determine the peripheral that geneated the interrupt and dispatch
- *   handling to the registered interrupt handler via xtensa_irq_dispatch().
+ *   Determine the peripheral(s) that generated the CPU interrupt(s) and
+ *   dispatch handling to the registered interrupt handlers via
+ *   xtensa_irq_dispatch().  Several peripherals may share one CPU
+ *   interrupt:  Only the sources routed to the pending CPU interrupts
+ *   are examined and only those that are pending in the DPORT interrupt
+ *   status registers are dispatched.
  *
  * Input Parameters:
- *   regs - Saves processor state on the stack
+ *   cpuints - Set of pending CPU interrupts to be decoded
+ *   regs    - Saves processor state on the stack
  *
  * Returned Value:
  *   Normally the same vale as regs is returned.  But, in the event of an
@@ -84,70 +72,72 @@ static const uint8_t g_nirqs[3] =
  *
  ****************************************************************************/
 
-uint32_t *xtensa_int_decode(uint32_t *regs)
+uint32_t *xtensa_int_decode(uint32_t cpuints, uint32_t *regs)
 {
+  FAR const uint32_t *sources;
   uintptr_t regaddr;
-  uint32_t regval;
-  uint32_t mask;
+  uint32_t pending;
+  int cpuint;
   int regndx;
-  int bit;
-  int baseirq;
-  int nirqs;
-
-#ifdef CONFIG_SMP
+  int periph;
   int cpu;
 
   /* Select PRO or APP interrupt status registers */
 
+#ifdef CONFIG_SMP
   cpu = up_cpu_index();
-  if (cpu == 0)
+  if (cpu != 0)
     {
-      regaddr = DPORT_PRO_INTR_STATUS_0_REG;
+      regaddr = DPORT_APP_INTR_STATUS_0_REG;
     }
   else
+#else
+  cpu = 0;
 #endif
     {
-      regaddr = DPORT_APP_INTR_STATUS_0_REG;
+      regaddr = DPORT_PRO_INTR_STATUS_0_REG;
     }
 
-  /* Process each pending interrupt in each of the three interrupt status
-   * registers.
-   */
+  /* Process each pending CPU interrupt */
 
-  for (regndx = 0; regndx < 3; regndx++)
+  while (cpuints != 0)
     {
-      /* Fetch the next register status register */
-
-      regval   = getreg32(regaddr);
-      regaddr += sizeof(uint32_t);
-
-      /* Set up the search */
-
-      baseirq = g_baseirq[regndx];
-      nirqs   = g_nirqs[regndx];
+      cpuint   = __builtin_ctz(cpuints);
+      cpuints &= ~(1ul << cpuint);
+      sources  = g_cpuint_sources[cpu][cpuint];
 
-      /* Decode and dispatch each pending bit in the interrupt status
-       * register.
+      /* Examine only the status registers holding sources that are routed
+       * to this CPU interrupt.
        */
 
-      for (bit = 0; regval != 0 && bit < nirqs; bit++)
+      for (regndx = 0; regndx < ESP32_NSTATUSREGS; regndx++)
         {
-          /* Check if this interrupt is pending */
+          if (sources[regndx] == 0)
+            {
+              continue;
+            }
+
+          pending = getreg32(regaddr + regndx * sizeof(uint32_t)) &
+                    sources[regndx];
 
-          mask = (1 << bit);
-          if ((regval & mask) != 0)
+          /* Dispatch each pending source.  Note that regs may be altered in
+           * the case of an interrupt level context switch.
+           */
+
+          while (pending != 0)
             {
-              /* Yes.. Dispatch the interrupt.  Note that regs may be
-               * altered in the case of an interrupt level context switch.
-               */
+              periph   = __builtin_ctz(pending);
+              pending &= ~(1ul << periph);
+              periph  += regndx << 5;
 
-              regs = xtensa_irq_dispatch(baseirq + bit, regs);
+#ifdef CONFIG_ESP32_IRQ_BALANCE
+              /* Account for the interrupt load of this peripheral */
 
-              /* Clear this bit in the sampled status register so that
-               * perhaps we can exit this loop sooner.
-               */
+              g_periph_load[periph]++;
+#endif
 
-              regval &= ~mask;
+              regs = xtensa_irq_dispatch(XTENSA_IRQ_FIRSTPERIPH + periph,
+                                         regs);
             }
         }
     }
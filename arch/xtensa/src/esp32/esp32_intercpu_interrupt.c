@@ -41,32 +41,37 @@
 
 #include <sys/types.h>
 #include <stdint.h>
-#include <sched.h>
 #include <assert.h>
 #include <errno.h>
 
-#include <nuttx/spinlock.h>
 #include <arch/irq.h>
 
 #include "chip/esp32_dport.h"
 #include "xtensa.h"
+#include "esp32_cpuint.h"
+#include "esp32_cpumsg.h"
 
 #ifdef CONFIG_SMP
 
 /****************************************************************************
- * Private Data
+ * Pre-processor Definitions
  ****************************************************************************/
 
-/* Single parameter passed with the inter-CPU interrupt */
+/* Number of times a sender retries to queue a message in a full ring
+ * before giving up.
+ */
 
-static volatile uint8_t g_intcode[CONFIG_SMP_NCPUS];
+#define CPUMSG_MAXRETRIES  100000
 
-/* Spinlock protects parameter array */
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
 
-static volatile spinlock_t g_intercpu_spin[CONFIG_SMP_NCPUS] =
-{
-  SP_UNLOCKED, SP_UNLOCKED
-};
+/* Message rings indexed by [sending CPU][receiving CPU].  Only the rings
+ * with sender != receiver are used.  Zero-initialized rings are empty.
+ */
+
+static struct esp32_cpuring_s g_cpuring[CONFIG_SMP_NCPUS][CONFIG_SMP_NCPUS];
 
 /****************************************************************************
  * Private Function
@@ -76,46 +81,60 @@ static volatile spinlock_t g_intercpu_spin[CONFIG_SMP_NCPUS] =
  * Name: esp32_fromcpu_interrupt
  *
  * Description:
- *   Common logic called to handle the from CPU0/1 interrupts.
+ *   Common logic called to handle the from CPU0/1 interrupts.  All messages
+ *   queued by the sending CPU are processed, not just the one that raised
+ *   the interrupt.
  *
  ****************************************************************************/
 
 static int esp32_fromcpu_interrupt(int fromcpu)
 {
+  struct esp32_cpuring_s *ring;
+  struct esp32_cpumsg_s msg;
   uintptr_t regaddr;
-  int intcode;
   int tocpu;
 
-  DEBUGASSERT(regs != NULL);
+  DEBUGASSERT((unsigned)fromcpu < CONFIG_SMP_NCPUS);
 
-  /* Clear the interrupt from the other CPU */
+  /* Clear the interrupt from the other CPU before draining the ring.  A
+   * message queued after this point will raise the interrupt again, so
+   * none can be missed.
+   */
 
   regaddr = (fromcpu == 0) ? DPORT_CPU_INTR_FROM_CPU_0_REG :
                              DPORT_CPU_INTR_FROM_CPU_1_REG;
   putreg32(0, regaddr);
 
-  /* Get the the inter-CPU interrupt code */
-
-  tocpu            = up_cpu_index();
-  intcode          = g_intcode[tocpu];
-  g_intcode[tocpu] = CPU_INTCODE_NONE;
+  tocpu = up_cpu_index();
+  DEBUGASSERT(tocpu != fromcpu);
 
-  spin_unlock(&g_intercpu_spin[tocpu]);
+  ring = &g_cpuring[fromcpu][tocpu];
 
-  /* Dispatch the inter-CPU interrupt based on the intcode value */
+  /* Dispatch each inter-CPU message based on its message code */
 
-  switch (intcode)
+  while (esp32_cpuring_get(ring, &msg))
     {
-      case CPU_INTCODE_NONE:
-        break;
-
-      case CPU_INTCODE_PAUSE:
-        xtensa_pause_handler();
-        break;
-
-      default:
-        DEBUGPANIC();
-        break;
+      switch (msg.code)
+        {
+          case CPU_INTCODE_NONE:
+            break;
+
+          case CPU_INTCODE_PAUSE:
+            xtensa_pause_handler();
+            break;
+
+          case CPU_INTCODE_IRQMIGRATE:
+            esp32_irq_migrate_handler();
+            break;
+
+          case CPU_INTCODE_CALL:
+            xtensa_cpucall_handler((FAR struct xtensa_cpucall_s *)msg.arg[0]);
+            break;
+
+          default:
+            DEBUGPANIC();
+            break;
+        }
     }
 
   return OK;
@@ -144,48 +163,85 @@ int esp32_fromcpu1_interrupt(int irq, FAR void *context)
 }
 
 /****************************************************************************
- * Name: xtensa_intercpu_interrupt
+ * Name: xtensa_intercpu_send
  *
  * Description:
- *   Called to trigger a CPU interrupt
+ *   Queue a message with two arguments for another CPU and interrupt that
+ *   CPU.  Messages from one CPU to another are processed in the order that
+ *   they were sent.  If the ring is full, this waits for the other CPU to
+ *   make room, with local interrupts restored to their state on entry so
+ *   that this CPU can meanwhile take the messages sent to it.
+ *
+ * Input Parameters:
+ *   tocpu   - The CPU to receive the message.  May not be this CPU.
+ *   intcode - The message code (CPU_INTCODE_*)
+ *   arg0    - First message argument
+ *   arg1    - Second message argument
+ *
+ * Returned Value:
+ *   OK on success;  -EAGAIN if the ring stayed full.
  *
  ****************************************************************************/
 
-int xtensa_intercpu_interrupt(int tocpu, int intcode)
+int xtensa_intercpu_send(int tocpu, int intcode, uintptr_t arg0,
+                         uintptr_t arg1)
 {
+  struct esp32_cpuring_s *ring;
+  struct esp32_cpumsg_s msg;
+  irqstate_t flags;
   int fromcpu;
+  int retries;
 
-  DEBUGASSERT((unsigned)cpu < CONFIG_SMP_NCPUS &&
-              (unsigned)incode <= UINT8_MAX);
+  DEBUGASSERT((unsigned)tocpu < CONFIG_SMP_NCPUS &&
+              (unsigned)intcode <= UINT8_MAX);
 
-  /* Disable context switching so that some other thread does not attempt to
-   * take the spinlock on the same CPU.
-   */
-
-  sched_lock();
+  msg.code   = (uint8_t)intcode;
+  msg.arg[0] = arg0;
+  msg.arg[1] = arg1;
 
-  /* Make sure that each inter-cpu event is atomic.  The spinlock should
-   * only be locked if we just completed sending an interrupt to this
-   * CPU but the other CPU has not yet processed it.
+  /* Disable local interrupts so that this CPU cannot migrate and so that
+   * this is the only producer for the ring.
    */
 
-  spin_lock(&g_intercpu_spin[tocpu]);
-
-  /* Save the passed parameter.  The previous interrupt code should be
-   * CPU_INTCODE_NONE or we have overrun the other CPU.
-   */
+  flags   = up_irq_save();
+  fromcpu = up_cpu_index();
+  DEBUGASSERT(fromcpu != tocpu);
 
-  DEBUGASSERT(g_intcode[tocpu] == CPU_INTCODE_NONE);
-  g_intcode[tocpu] = intcode;
+  ring = &g_cpuring[fromcpu][tocpu];
+  for (retries = 0; !esp32_cpuring_put(ring, &msg); retries++)
+    {
+      /* The ring is full.  The other CPU has interrupts pending from us
+       * and will drain the ring, unless it is itself waiting for room in
+       * its ring to us or for a lock that we hold.  Do not wait forever.
+       */
+
+      if (retries >= CPUMSG_MAXRETRIES)
+        {
+          up_irq_restore(flags);
+          return -EAGAIN;
+        }
+
+      /* Let the FROM_CPU interrupt drain this CPU's own inbound ring while
+       * we wait (if the caller has local interrupts enabled).  This thread
+       * may then move to another CPU.
+       */
+
+      up_irq_restore(flags);
+      flags   = up_irq_save();
+      fromcpu = up_cpu_index();
+      if (fromcpu == tocpu)
+        {
+          up_irq_restore(flags);
+          return -EAGAIN;
+        }
+
+      ring = &g_cpuring[fromcpu][tocpu];
+    }
 
-  /* Interrupt the other CPU (tocpu) form this CPU.  NOTE: that this logic
-   * fails in numerous ways if fromcpu == tocpu (for example because non-
-   * reentrant spinlocks are used).
+  /* Interrupt the other CPU (tocpu) from this CPU.  If the interrupt is
+   * still pending, the messages are simply processed together.
    */
 
-  fromcpu = up_cpu_index();
-  DEBUGASSERT(fromcpu != tocpu);
-
   if (fromcpu == 0)
     {
       putreg32(DPORT_CPU_INTR_FROM_CPU_0, DPORT_CPU_INTR_FROM_CPU_0_REG);
@@ -195,8 +251,21 @@ int xtensa_intercpu_interrupt(int tocpu, int intcode)
       putreg32(DPORT_CPU_INTR_FROM_CPU_1, DPORT_CPU_INTR_FROM_CPU_1_REG);
     }
 
-  sched_unlock();
+  up_irq_restore(flags);
   return OK;
 }
 
+/****************************************************************************
+ * Name: xtensa_intercpu_interrupt
+ *
+ * Description:
+ *   Called to trigger a CPU interrupt
+ *
+ ****************************************************************************/
+
+int xtensa_intercpu_interrupt(int tocpu, int intcode)
+{
+  return xtensa_intercpu_send(tocpu, intcode, 0, 0);
+}
+
 #endif /* CONFIG_SMP */
@@ -54,23 +54,14 @@
  * Public Data
  ****************************************************************************/
 
-/* g_current_regs[] holds a references to the current interrupt level
- * register storage structure.  If is non-NULL only during interrupt
- * processing.  Access to g_current_regs[] must be through the macro
- * CURRENT_REGS for portability.
+/* g_percpu[] holds the per-CPU data, including the CURRENT_REGS value of
+ * each CPU.  See xtensa_percpu().
  */
 
 #ifdef CONFIG_SMP
-/* For the case of architectures with multiple CPUs, then there must be one
- * such value for each processor that can receive an interrupt.
- */
-
-volatile uint32_t *g_current_regs[CONFIG_SMP_NCPUS];
-
+struct xtensa_percpu_s g_percpu[CONFIG_SMP_NCPUS];
 #else
-
-volatile uint32_t *g_current_regs[1];
-
+struct xtensa_percpu_s g_percpu[1];
 #endif
 
 /****************************************************************************
@@ -123,7 +114,7 @@ static inline void xtensa_attach_fromcpu1_interrupt(void)
 
   /* Allocate a level-sensitive, priority 1 CPU interrupt for the UART */
 
-  cpuint = esp32_alloc_levelint(1);
+  cpuint = esp32_alloc_levelint(0, 1);
   DEBUGASSERT(cpuint >= 0);
 
   /* Connect all CPU peripheral source to allocated CPU interrupt */
@@ -151,18 +142,15 @@ static inline void xtensa_attach_fromcpu1_interrupt(void)
 
 void xtensa_irq_initialize(void)
 {
-  int i;
-
   /* Disable all PRO CPU interrupts */
 
   xtensa_disable_all();
 
-  /* Detach all peripheral sources PRO CPU interrupts */
+  /* Detach all peripheral sources PRO CPU interrupts and enable the CPU
+   * interrupts that peripherals may be routed to.
+   */
 
-  for (i = 0; i < ESP32_NPERIPHERALS; i++)
-    {
-      esp32_detach_peripheral(0, i);
-    }
+  esp32_cpuint_initialize();
 
 #if defined(CONFIG_STACK_COLORATION) && CONFIG_ARCH_INTERRUPTSTACK > 3
   /* Colorize the interrupt stack for debug purposes */
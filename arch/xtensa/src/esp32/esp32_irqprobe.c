@@ -0,0 +1,251 @@
+/****************************************************************************
+ * arch/xtensa/src/esp32/esp32_irqprobe.c
+ *
+ *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sched.h>
+#include <errno.h>
+
+#include <nuttx/irq.h>
+#include <arch/irq.h>
+#include <arch/xtensa/xtensa_swstats.h>
+
+#include "chip/esp32_dport.h"
+#include "xtensa.h"
+#include "esp32_cpuint.h"
+#include "esp32_irqprobe.h"
+
+#ifdef CONFIG_ESP32_IRQPROBE
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The long-running handler is a priority 1 interrupt raised by the CPU3
+ * software peripheral interrupt.  The measured handler is a medium
+ * priority interrupt raised by the CPU2 software peripheral interrupt.
+ */
+
+#define ESP32_IRQPROBE_HOLDLEVEL    1
+#define ESP32_IRQPROBE_PROBELEVEL   XCHAL_EXCM_LEVEL
+
+/* Give up on a sample if it has not completed this many cycles after the
+ * hold time.
+ */
+
+#define ESP32_IRQPROBE_TIMEOUT      1000000
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static volatile uint32_t g_probe_hold;     /* Cycles to hold the CPU */
+static volatile uint32_t g_probe_trigger;  /* CCOUNT when CPU2 was raised */
+static volatile uint32_t g_probe_done;     /* Number of completed samples */
+static bool g_probe_busy;                  /* A probe is in progress */
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name:  esp32_irqprobe_hold
+ *
+ * Description:
+ *   Priority 1 interrupt:  Raise the measured interrupt then occupy the
+ *   CPU for the hold time.
+ *
+ ****************************************************************************/
+
+static int esp32_irqprobe_hold(int irq, FAR void *context)
+{
+  uint32_t start;
+
+  putreg32(0, DPORT_CPU_INTR_FROM_CPU_3_REG);
+
+  start           = xtensa_getccount();
+  g_probe_trigger = start;
+  putreg32(1, DPORT_CPU_INTR_FROM_CPU_2_REG);
+
+  while (xtensa_getccount() - start < g_probe_hold)
+    {
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name:  esp32_irqprobe_measure
+ *
+ * Description:
+ *   Medium priority interrupt:  Record the time since it was raised.
+ *
+ ****************************************************************************/
+
+static int esp32_irqprobe_measure(int irq, FAR void *context)
+{
+  uint32_t now = xtensa_getccount();
+
+  putreg32(0, DPORT_CPU_INTR_FROM_CPU_2_REG);
+  xtensa_swstat_record(XTENSA_SWSTAT_IRQLATENCY, now - g_probe_trigger);
+  g_probe_done++;
+
+  return OK;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name:  esp32_irqprobe_run
+ *
+ * Description:
+ *   Measure the entry latency of a medium priority interrupt that is
+ *   raised while a priority 1 interrupt handler runs.
+ *
+ ****************************************************************************/
+
+int esp32_irqprobe_run(int nsamples, uint32_t holdcycles)
+{
+  irqstate_t flags;
+  uint32_t start;
+  uint32_t done;
+  int holdint;
+  int probeint;
+  int cpu;
+  int ret = OK;
+  int i;
+
+  if (nsamples <= 0)
+    {
+      return -EINVAL;
+    }
+
+  flags = enter_critical_section();
+  if (g_probe_busy)
+    {
+      leave_critical_section(flags);
+      return -EBUSY;
+    }
+
+  g_probe_busy = true;
+  leave_critical_section(flags);
+
+  /* Both interrupts must be taken by the same CPU.  They are attached
+   * with esp32_attach_peripheral() so that the load balancer does not
+   * move them.
+   */
+
+  sched_lock();
+
+#ifdef CONFIG_SMP
+  cpu = up_cpu_index();
+#else
+  cpu = 0;
+#endif
+
+  holdint = esp32_alloc_levelint(cpu, ESP32_IRQPROBE_HOLDLEVEL);
+  if (holdint < 0)
+    {
+      ret = holdint;
+      goto errout_with_lock;
+    }
+
+  probeint = esp32_alloc_levelint(cpu, ESP32_IRQPROBE_PROBELEVEL);
+  if (probeint < 0)
+    {
+      ret = probeint;
+      goto errout_with_holdint;
+    }
+
+  g_probe_hold = holdcycles;
+  g_probe_done = 0;
+
+  (void)irq_attach(ESP32_IRQ_CPU_CPU3, (xcpt_t)esp32_irqprobe_hold);
+  (void)irq_attach(ESP32_IRQ_CPU_CPU2, (xcpt_t)esp32_irqprobe_measure);
+  esp32_attach_peripheral(cpu, ESP32_PERIPH_CPU_CPU2, probeint);
+  esp32_attach_peripheral(cpu, ESP32_PERIPH_CPU_CPU3, holdint);
+
+  for (i = 0; i < nsamples; i++)
+    {
+      done  = g_probe_done;
+      start = xtensa_getccount();
+      putreg32(1, DPORT_CPU_INTR_FROM_CPU_3_REG);
+
+      while (g_probe_done == done)
+        {
+          if (xtensa_getccount() - start >
+              holdcycles + ESP32_IRQPROBE_TIMEOUT)
+            {
+              ret = -ETIMEDOUT;
+              break;
+            }
+        }
+
+      if (ret < 0)
+        {
+          break;
+        }
+    }
+
+  esp32_detach_peripheral(cpu, ESP32_PERIPH_CPU_CPU3);
+  esp32_detach_peripheral(cpu, ESP32_PERIPH_CPU_CPU2);
+  putreg32(0, DPORT_CPU_INTR_FROM_CPU_3_REG);
+  putreg32(0, DPORT_CPU_INTR_FROM_CPU_2_REG);
+  irq_detach(ESP32_IRQ_CPU_CPU2);
+  irq_detach(ESP32_IRQ_CPU_CPU3);
+
+  esp32_free_cpuint(cpu, probeint);
+
+errout_with_holdint:
+  esp32_free_cpuint(cpu, holdint);
+
+errout_with_lock:
+  sched_unlock();
+
+  flags = enter_critical_section();
+  g_probe_busy = false;
+  leave_critical_section(flags);
+  return ret;
+}
+
+#endif /* CONFIG_ESP32_IRQPROBE */
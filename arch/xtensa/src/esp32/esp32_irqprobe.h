@@ -0,0 +1,86 @@
+/****************************************************************************
+ * arch/xtensa/src/esp32/esp32_irqprobe.h
+ *
+ *   Copyright (C) 2016 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __ARCH_XTENSA_SRC_ESP32_ESP32_IRQPROBE_H
+#define __ARCH_XTENSA_SRC_ESP32_ESP32_IRQPROBE_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+
+#ifdef CONFIG_ESP32_IRQPROBE
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name:  esp32_irqprobe_run
+ *
+ * Description:
+ *   Measure the entry latency of a medium priority interrupt that is
+ *   raised while a priority 1 interrupt handler runs.  For each sample, a
+ *   priority 1 handler on the CPU of the caller raises the medium priority
+ *   interrupt, then busy-waits for 'holdcycles' CCOUNT cycles.  The cycles
+ *   from the request to the entry of the medium priority handler are
+ *   recorded in the XTENSA_SWSTAT_IRQLATENCY statistic of that CPU and may
+ *   be read with xtensa_swstat_get().
+ *
+ *   With CONFIG_XTENSA_NESTED_INTERRUPTS, the latency should not depend
+ *   on 'holdcycles'.  Otherwise, it includes the whole hold time.
+ *
+ *   The CPU2 and CPU3 software peripheral interrupts are used for the
+ *   duration of the probe.
+ *
+ * Input Parameters:
+ *   nsamples   - The number of samples to take
+ *   holdcycles - The duration of the priority 1 handler in CCOUNT cycles
+ *
+ * Returned Value:
+ *   Zero (OK) on success; a negated errno value on failure:  -EINVAL if
+ *   'nsamples' is not positive, -EBUSY if a probe is already in progress,
+ *   -ENOMEM if no CPU interrupt is free or -ETIMEDOUT if a sample did not
+ *   complete.
+ *
+ ****************************************************************************/
+
+int esp32_irqprobe_run(int nsamples, uint32_t holdcycles);
+
+#endif /* CONFIG_ESP32_IRQPROBE */
+#endif /* __ARCH_XTENSA_SRC_ESP32_ESP32_IRQPROBE_H */
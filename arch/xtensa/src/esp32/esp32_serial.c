@@ -39,6 +39,11 @@
 
 #include <nuttx/config.h>
 
+#if defined(CONFIG_ESP32_UART_STATS) && defined(CONFIG_FS_PROCFS) && \
+    defined(CONFIG_FS_PROCFS_REGISTER)
+#  define HAVE_UART_PROCFS 1
+#endif
+
 #include <sys/types.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -48,27 +53,51 @@
 #include <errno.h>
 #include <debug.h>
 
+#ifdef HAVE_UART_PROCFS
+#  include <stdio.h>
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#endif
+
 #ifdef CONFIG_SERIAL_TERMIOS
 #  include <termios.h>
 #endif
 
 #include <nuttx/irq.h>
 #include <nuttx/arch.h>
+#include <nuttx/clock.h>
+#include <nuttx/wdog.h>
 #include <nuttx/serial/serial.h>
 
+#ifdef HAVE_UART_PROCFS
+#  include <nuttx/kmalloc.h>
+#  include <nuttx/fs/procfs.h>
+#endif
+
 #include <arch/serial.h>
 #include <arch/board/board.h>
+#include <arch/xtensa/xtensa_atomic.h>
 
 #include "xtensa.h"
 #include "chip/esp32_soc.h"
 #include "chip/esp32_iomux.h"
 #include "chip/esp32_gpio_sigmap.h"
 #include "chip/esp32_uart.h"
+#include "chip/esp32_dport.h"
+#include "chip/esp32_uhci.h"
 #include "rom/esp32_gpio.h"
 #include "esp32_config.h"
 #include "esp32_gpio.h"
 #include "esp32_cpuint.h"
 
+#ifdef CONFIG_ESP32_UART_AUTOBAUD
+#  include "esp32_autobaud.h"
+#endif
+
+#if defined(CONFIG_ESP32_UART_LOCKFREE) && defined(CONFIG_SMP)
+#  include "xtensa_spinlock.h"
+#endif
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -137,6 +166,96 @@
 
 #define UART_CLK_FREQ         APB_CLK_FREQ
 
+/* Hardware FIFO depth and default interrupt thresholds.  The RX FIFO
+ * interrupts when it holds UART_RXFULL_THRHD bytes (or after
+ * UART_RXTOUT_THRHD idle symbol times);  the TX FIFO interrupts when it
+ * drops below UART_TXEMPTY_THRHD bytes and is then refilled in one burst.
+ * The thresholds may be changed per UART with TIOCSFIFOCONF.
+ */
+
+#define UART_FIFO_SIZE        128
+
+/* RX FIFO level at which RTS is deasserted when flow control is enabled */
+
+#define UART_RXFLOW_THRHD     (UART_FIFO_SIZE - 16)
+
+#ifndef CONFIG_ESP32_UART_RXFULL_THRHD
+#  define CONFIG_ESP32_UART_RXFULL_THRHD 112
+#endif
+
+#ifndef CONFIG_ESP32_UART_RXTOUT
+#  define CONFIG_ESP32_UART_RXTOUT 2
+#endif
+
+#ifndef CONFIG_ESP32_UART_TXEMPTY_THRHD
+#  define CONFIG_ESP32_UART_TXEMPTY_THRHD 16
+#endif
+
+#define UART_RXFULL_THRHD     CONFIG_ESP32_UART_RXFULL_THRHD
+#define UART_RXTOUT_THRHD     CONFIG_ESP32_UART_RXTOUT
+#define UART_TXEMPTY_THRHD    CONFIG_ESP32_UART_TXEMPTY_THRHD
+
+/* Receive error interrupts.  Parity errors only matter for the statistics:
+ * The character is still received.
+ */
+
+#ifdef CONFIG_ESP32_UART_STATS
+#  define UART_ERR_INT_ENA    (UART_FRM_ERR_INT_ENA | UART_PARITY_ERR_INT_ENA)
+#else
+#  define UART_ERR_INT_ENA    UART_FRM_ERR_INT_ENA
+#endif
+
+#ifdef HAVE_UART_PROCFS
+/* A line of statistics is up to 106 characters:  The port name, nine
+ * counters of up to 10 digits, the separators and the newline.
+ */
+
+#  define UART_PROCFS_LINELEN 112
+#  define UART_PROCFS_NPORTS  (sizeof(g_uart_procfs_ports) / \
+                               sizeof(g_uart_procfs_ports[0]))
+#endif
+
+#ifdef CONFIG_ESP32_UART_ADAPTIVE
+#  define UART_ADAPT_MINFULL  16  /* Lowest RX full threshold after overflows */
+#  define UART_ADAPT_STEP     16  /* RX full threshold step per overflow */
+#endif
+
+/* UHCI DMA.  The two UHCI engines are given to the DMA UARTs in order */
+
+#ifdef CONFIG_ESP32_UART_DMA
+#  if defined(CONFIG_ESP32_UART0_DMA) && defined(CONFIG_ESP32_UART1_DMA) && \
+      defined(CONFIG_ESP32_UART2_DMA)
+#    error "Only two UARTs may use UHCI DMA"
+#  endif
+
+#  ifdef CONFIG_ESP32_UART0_DMA
+#    define UART0_UHCI        0
+#  endif
+
+#  ifdef CONFIG_ESP32_UART1_DMA
+#    ifdef CONFIG_ESP32_UART0_DMA
+#      define UART1_UHCI      1
+#    else
+#      define UART1_UHCI      0
+#    endif
+#  endif
+
+#  ifdef CONFIG_ESP32_UART2_DMA
+#    if defined(CONFIG_ESP32_UART0_DMA) || defined(CONFIG_ESP32_UART1_DMA)
+#      define UART2_UHCI      1
+#    else
+#      define UART2_UHCI      0
+#    endif
+#  endif
+
+#  define UART_DMA_NRXDESC    CONFIG_ESP32_UART_DMA_RXDESC
+#  define UART_DMA_RXSIZE     ((CONFIG_ESP32_UART_DMA_RXSIZE + 3) & ~3)
+
+#  define UART_DMA_RXINTS     (UHCI_IN_SUC_EOF_INT | UHCI_IN_DONE_INT | \
+                               UHCI_IN_DSCR_EMPTY_INT)
+#  define UART_DMA_TXINTS     (UHCI_OUT_TOTAL_EOF_INT)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -160,23 +279,104 @@ struct esp32_config_s
   uint8_t  rtssig;              /* RTS signal */
   uint8_t  ctssig;              /* CTS signal */
 #endif
+#ifdef CONFIG_ESP32_UART_RS485
+  uint8_t  depin;               /* RS-485 driver enable pin number (0-39) */
+  uint8_t  desig;               /* RS-485 driver enable signal (RTS) */
+#endif
+};
+
+#ifdef CONFIG_ESP32_UART_DMA
+/* DMA linked list descriptor */
+
+struct esp32_dmadesc_s
+{
+  volatile uint32_t ctrl;       /* Size, length and flags */
+  FAR uint8_t *buf;             /* Data buffer */
+  FAR struct esp32_dmadesc_s *next; /* Next descriptor or NULL */
+};
+
+/* State of the UHCI DMA engine serving one UART.  Received data is
+ * gathered in a ring of word aligned buffers (as required for in links)
+ * and copied into the receive buffer a descriptor at a time.  Transmit
+ * out links point directly into the transmit buffer.
+ */
+
+struct esp32_dma_s
+{
+  const uint32_t uhcibase;      /* Base address of UHCI registers */
+  xcpt_t   handler;             /* UHCI interrupt handler */
+  uint32_t uartce;              /* UHCI_UARTn_CE bit selecting the UART */
+  uint8_t  periph;              /* UHCI peripheral ID */
+  uint8_t  irq;                 /* IRQ number assigned to the UHCI */
+  uint8_t  rxnext;              /* Next Rx descriptor to be returned */
+  bool     rxstalled;           /* In link ran out of descriptors */
+  uint16_t rxoffset;            /* Bytes of rxnext already passed upward */
+  uint16_t txlen;               /* Bytes in flight (0: Tx DMA idle) */
+  struct esp32_dmadesc_s txdesc[2];
+  struct esp32_dmadesc_s rxdesc[UART_DMA_NRXDESC];
+  uint32_t rxbuffer[UART_DMA_NRXDESC][UART_DMA_RXSIZE / 4];
 };
+#endif
 
 /* Current state of the UART */
 
 struct esp32_dev_s
 {
   const struct esp32_config_s *config; /* Constant configuration */
+#ifdef CONFIG_ESP32_UART_DMA
+  struct esp32_dma_s *dma;      /* UHCI DMA state or NULL */
+#endif
+#if defined(CONFIG_ESP32_UART_LOCKFREE) && defined(CONFIG_SMP)
+  struct xtensa_ticketlock_s intlock; /* Serializes INT_ENA updates */
+#endif
   uint32_t baud;                /* Configured baud */
   uint32_t status;              /* Saved status bits */
-  uint8_t  cpuint;              /* CPU interrupt assigned to this UART */
   uint8_t  parity;              /* 0=none, 1=odd, 2=even */
   uint8_t  bits;                /* Number of bits (5-9) */
   bool     stopbits2;           /* true: Configure with 2 stop bits instead of 1 */
 #if defined(CONFIG_SERIAL_IFLOWCONTROL) || defined(CONFIG_SERIAL_OFLOWCONTROL)
   bool     flowc;               /* Input flow control (RTS) enabled */
 #endif
+  uint8_t  rxfull;              /* RX FIFO full threshold (bytes) */
+  uint8_t  rxtout;              /* RX timeout (symbol times, 0=disabled) */
+  uint8_t  txempty;             /* TX FIFO empty threshold (bytes) */
+#ifdef CONFIG_ESP32_UART_RS485
+  bool     txactive;            /* RS-485 driver enable asserted */
+  struct serial_rs485 rs485;    /* RS-485 configuration (TIOCSRS485) */
+  WDOG_ID  rs485wd;             /* Times the delay after send */
+#endif
+#ifdef CONFIG_ESP32_UART_ADAPTIVE
+  bool     adaptive;            /* Adapt rxfull/rxtout to the byte rate */
+  uint8_t  currxfull;           /* RX full threshold now in CONF1 */
+  uint8_t  currxtout;           /* RX timeout now in CONF1 */
+  uint32_t rxbytes;             /* Bytes received in this window */
+  systime_t rxstart;            /* Start time of this window */
+#endif
+#ifdef CONFIG_ESP32_UART_AUTOBAUD
+  bool     autobaud;            /* Baud rate detection in progress */
+#endif
+#ifdef CONFIG_ESP32_UART_STATS
+  struct uart_stats_s stats;    /* Traffic and error counters */
+#endif
+#ifdef CONFIG_ESP32_UART_PATTERN
+  bool     pattern;             /* Delimiter detection enabled */
+  uint8_t  pathead;             /* Oldest entry in patpos[] */
+  uint8_t  patcount;            /* Number of entries in patpos[] */
+  uint32_t rxin;                /* Bytes stored in the RX buffer so far */
+  uint32_t patpos[CONFIG_ESP32_UART_PATTERN_QUEUE]; /* rxin after each
+                                                     * delimiter */
+#endif
+};
+
+#ifdef HAVE_UART_PROCFS
+/* One open instance of /proc/uart */
+
+struct esp32_procfs_file_s
+{
+  struct procfs_file_s base;    /* Base open file structure */
+  char line[UART_PROCFS_LINELEN]; /* Pre-allocated buffer for formatted lines */
 };
+#endif
 
 /****************************************************************************
  * Private Function Prototypes
@@ -196,15 +396,45 @@ static int  esp32_uart1_interrupt(int cpuint, void *context);
 #ifdef CONFIG_ESP32_UART2
 static int  esp32_uart2_interrupt(int cpuint, void *context);
 #endif
+#ifdef CONFIG_ESP32_UART_DMA
+static void esp32_dma_setup(struct uart_dev_s *dev);
+static void esp32_dma_shutdown(struct uart_dev_s *dev);
+static void esp32_dma_rxdrain(struct uart_dev_s *dev);
+static int  esp32_dma_interrupt(struct uart_dev_s *dev);
+#ifdef CONFIG_ESP32_UART0_DMA
+static int  esp32_uart0_dma_interrupt(int cpuint, void *context);
+#endif
+#ifdef CONFIG_ESP32_UART1_DMA
+static int  esp32_uart1_dma_interrupt(int cpuint, void *context);
+#endif
+#ifdef CONFIG_ESP32_UART2_DMA
+static int  esp32_uart2_dma_interrupt(int cpuint, void *context);
+#endif
+#endif
 static int  esp32_ioctl(struct file *filep, int cmd, unsigned long arg);
 static int  esp32_receive(struct uart_dev_s *dev, unsigned int *status);
+static void esp32_rxburst(struct uart_dev_s *dev, unsigned int count);
+static unsigned int esp32_txburst(struct uart_dev_s *dev, unsigned int room);
 static void esp32_rxint(struct uart_dev_s *dev, bool enable);
+#ifdef CONFIG_SERIAL_TERMIOS
+static void esp32_rxflush(struct uart_dev_s *dev);
+#endif
 static bool esp32_rxavailable(struct uart_dev_s *dev);
 static void esp32_send(struct uart_dev_s *dev, int ch);
 static void esp32_txint(struct uart_dev_s *dev, bool enable);
 static bool esp32_txready(struct uart_dev_s *dev);
 static bool esp32_txempty(struct uart_dev_s *dev);
 
+#ifdef HAVE_UART_PROCFS
+static int  esp32_procfs_open(struct file *filep, const char *relpath,
+                              int oflags, mode_t mode);
+static int  esp32_procfs_close(struct file *filep);
+static ssize_t esp32_procfs_read(struct file *filep, char *buffer,
+                                 size_t buflen);
+static int  esp32_procfs_dup(const struct file *oldp, struct file *newp);
+static int  esp32_procfs_stat(const char *relpath, struct stat *buf);
+#endif
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -262,15 +492,39 @@ static const struct esp32_config_s g_uart0config =
   .rtssig         = U0RTS_OUT_IDX,
   .ctssig         = U0CTS_IN_IDX,
 #endif
+#ifdef CONFIG_ESP32_UART_RS485
+  .depin          = CONFIG_ESP32_UART0_DEPIN,
+  .desig          = U0RTS_OUT_IDX,
+#endif
+};
+
+#ifdef CONFIG_ESP32_UART0_DMA
+static struct esp32_dma_s g_uart0dma =
+{
+  .uhcibase       = REG_UHCI_BASE(UART0_UHCI),
+  .handler        = esp32_uart0_dma_interrupt,
+  .uartce         = UHCI_UART0_CE,
+  .periph         = ESP32_PERIPH_UHCI0 + UART0_UHCI,
+  .irq            = ESP32_IRQ_UHCI0 + UART0_UHCI,
 };
+#endif
 
 static struct esp32_dev_s g_uart0priv =
 {
   .config         = &g_uart0config,
+#ifdef CONFIG_ESP32_UART0_DMA
+  .dma            = &g_uart0dma,
+#endif
   .baud           = CONFIG_UART0_BAUD,
   .parity         = CONFIG_UART0_PARITY,
   .bits           = CONFIG_UART0_BITS,
   .stopbits2      = CONFIG_UART0_2STOP,
+  .rxfull         = UART_RXFULL_THRHD,
+  .rxtout         = UART_RXTOUT_THRHD,
+  .txempty        = UART_TXEMPTY_THRHD,
+#ifdef CONFIG_ESP32_UART_ADAPTIVE
+  .adaptive       = true,
+#endif
 };
 
 static uart_dev_t g_uart0port =
@@ -309,15 +563,39 @@ static const struct esp32_config_s g_uart1config =
   .rtssig         = U1RTS_OUT_IDX,
   .ctssig         = U1CTS_IN_IDX,
 #endif
+#ifdef CONFIG_ESP32_UART_RS485
+  .depin          = CONFIG_ESP32_UART1_DEPIN,
+  .desig          = U1RTS_OUT_IDX,
+#endif
 };
 
+#ifdef CONFIG_ESP32_UART1_DMA
+static struct esp32_dma_s g_uart1dma =
+{
+  .uhcibase       = REG_UHCI_BASE(UART1_UHCI),
+  .handler        = esp32_uart1_dma_interrupt,
+  .uartce         = UHCI_UART1_CE,
+  .periph         = ESP32_PERIPH_UHCI0 + UART1_UHCI,
+  .irq            = ESP32_IRQ_UHCI0 + UART1_UHCI,
+};
+#endif
+
 static struct esp32_dev_s g_uart1priv =
 {
   .config         = &g_uart1config,
+#ifdef CONFIG_ESP32_UART1_DMA
+  .dma            = &g_uart1dma,
+#endif
   .baud           = CONFIG_UART1_BAUD,
   .parity         = CONFIG_UART1_PARITY,
   .bits           = CONFIG_UART1_BITS,
   .stopbits2      = CONFIG_UART1_2STOP,
+  .rxfull         = UART_RXFULL_THRHD,
+  .rxtout         = UART_RXTOUT_THRHD,
+  .txempty        = UART_TXEMPTY_THRHD,
+#ifdef CONFIG_ESP32_UART_ADAPTIVE
+  .adaptive       = true,
+#endif
 };
 
 static uart_dev_t g_uart1port =
@@ -356,15 +634,39 @@ static const struct esp32_config_s g_uart2config =
   .rtssig         = U2RTS_OUT_IDX,
   .ctssig         = U2CTS_IN_IDX,
 #endif
+#ifdef CONFIG_ESP32_UART_RS485
+  .depin          = CONFIG_ESP32_UART2_DEPIN,
+  .desig          = U2RTS_OUT_IDX,
+#endif
+};
+
+#ifdef CONFIG_ESP32_UART2_DMA
+static struct esp32_dma_s g_uart2dma =
+{
+  .uhcibase       = REG_UHCI_BASE(UART2_UHCI),
+  .handler        = esp32_uart2_dma_interrupt,
+  .uartce         = UHCI_UART2_CE,
+  .periph         = ESP32_PERIPH_UHCI0 + UART2_UHCI,
+  .irq            = ESP32_IRQ_UHCI0 + UART2_UHCI,
 };
+#endif
 
 static struct esp32_dev_s g_uart2priv =
 {
   .config         = &g_uart2config,
+#ifdef CONFIG_ESP32_UART2_DMA
+  .dma            = &g_uart2dma,
+#endif
   .baud           = CONFIG_UART2_BAUD,
   .parity         = CONFIG_UART2_PARITY,
   .bits           = CONFIG_UART2_BITS,
   .stopbits2      = CONFIG_UART2_2STOP,
+  .rxfull         = UART_RXFULL_THRHD,
+  .rxtout         = UART_RXTOUT_THRHD,
+  .txempty        = UART_TXEMPTY_THRHD,
+#ifdef CONFIG_ESP32_UART_ADAPTIVE
+  .adaptive       = true,
+#endif
 };
 
 static uart_dev_t g_uart2port =
@@ -384,6 +686,36 @@ static uart_dev_t g_uart2port =
 };
 #endif
 
+#ifdef HAVE_UART_PROCFS
+/* /proc/uart lists the ports in ttyS order */
+
+static struct uart_dev_s * const g_uart_procfs_ports[] =
+{
+  &TTYS0_DEV,
+#ifdef TTYS1_DEV
+  &TTYS1_DEV,
+#endif
+#ifdef TTYS2_DEV
+  &TTYS2_DEV,
+#endif
+};
+
+static const struct procfs_operations g_uart_procfs_ops =
+{
+  .open           = esp32_procfs_open,
+  .close          = esp32_procfs_close,
+  .read           = esp32_procfs_read,
+  .dup            = esp32_procfs_dup,
+  .stat           = esp32_procfs_stat,
+};
+
+static const struct procfs_entry_s g_uart_procfs_entry =
+{
+  .pathpattern    = "uart",
+  .ops            = &g_uart_procfs_ops,
+};
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -420,400 +752,2153 @@ static inline void esp32_restoreuartint(struct esp32_dev_s *priv,
 }
 
 /****************************************************************************
- * Name: esp32_disableallints
+ * Name: esp32_intlock and esp32_intunlock
+ *
+ * Description:
+ *   Serialize updates of the port's interrupt enables.  In lock-free mode
+ *   this is a per-port spinlock that never blocks the other CPU's
+ *   interrupts;  otherwise it is the global critical section.  Nothing may
+ *   be locked while this is held.
+ *
  ****************************************************************************/
 
-static void esp32_disableallints(struct esp32_dev_s *priv, uint32_t *intena)
+static inline irqstate_t esp32_intlock(struct esp32_dev_s *priv)
 {
-  irqstate_t flags;
+#ifdef CONFIG_ESP32_UART_LOCKFREE
+  irqstate_t flags = up_irq_save();
 
-  /* The following must be atomic */
+#ifdef CONFIG_SMP
+  xtensa_ticket_lock(&priv->intlock);
+#endif
+  return flags;
+#else
+  return enter_critical_section();
+#endif
+}
 
-  flags = enter_critical_section();
+static inline void esp32_intunlock(struct esp32_dev_s *priv,
+                                   irqstate_t flags)
+{
+#ifdef CONFIG_ESP32_UART_LOCKFREE
+#ifdef CONFIG_SMP
+  xtensa_ticket_unlock(&priv->intlock);
+#endif
+  up_irq_restore(flags);
+#else
+  leave_critical_section(flags);
+#endif
+}
 
-  if (intena)
-    {
-      /* Return the current interrupt mask */
+/****************************************************************************
+ * Name: esp32_modifyint
+ ****************************************************************************/
 
-      *intena = esp32_serialin(priv, UART_INT_ENA_OFFSET);
-    }
+static void esp32_modifyint(struct esp32_dev_s *priv, uint32_t clearbits,
+                            uint32_t setbits)
+{
+  irqstate_t flags;
+  uint32_t regval;
 
-  /* Disable all interrupts */
+  /* The read-modify-write must be atomic */
 
-  esp32_serialout(priv, UART_INT_ENA_OFFSET, 0);
-  leave_critical_section(flags);
+  flags   = esp32_intlock(priv);
+  regval  = esp32_serialin(priv, UART_INT_ENA_OFFSET);
+  regval &= ~clearbits;
+  regval |= setbits;
+  esp32_serialout(priv, UART_INT_ENA_OFFSET, regval);
+  esp32_intunlock(priv, flags);
 }
 
 /****************************************************************************
- * Name: esp32_setup
+ * Name: esp32_rxflowconf
  *
  * Description:
- *   Configure the UART baud, bits, parity, etc. This method is called the
- *   first time that the serial port is opened.
+ *   Return the CONF1 bits that let the hardware deassert RTS when the RX
+ *   FIFO fills.  Receive flow control is off in RS-485 mode, where RTS is
+ *   the driver enable.
  *
  ****************************************************************************/
 
-static int esp32_setup(struct uart_dev_s *dev)
+static uint32_t esp32_rxflowconf(struct esp32_dev_s *priv)
 {
-  struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
-#ifndef CONFIG_SUPPRESS_UART_CONFIG
-  uint32_t clkdiv;
-  uint32_t regval;
-  uint32_t conf0;
-
-  /* Note: The logic here depends on the fact that that the UART module
-   * was enabled and the pins were configured in esp32_lowsetup().
-   */
-
-  /* The shutdown method will put the UART in a known, disabled state */
-
-  esp32_shutdown(dev);
-
-  /* Set up the CONF0 register. */
-
-  conf0 = UART_TICK_REF_ALWAYS_ON;
-
 #if defined(CONFIG_SERIAL_IFLOWCONTROL) || defined(CONFIG_SERIAL_OFLOWCONTROL)
-  /* Check if flow control is enabled */
-
-  if (priv->flowc)
+  if (priv->flowc
+#ifdef CONFIG_ESP32_UART_RS485
+      && (priv->rs485.flags & SER_RS485_ENABLED) == 0
+#endif
+     )
     {
-      /* Enable hardware flow control */
-
-      conf0 |= UART_TX_FLOW_EN;
+      return ((uint32_t)UART_RXFLOW_THRHD << UART_RX_FLOW_THRHD_S) |
+             UART_RX_FLOW_EN;
     }
 #endif
 
-  /* OR in settings for the selected number of bits */
+  return 0;
+}
 
-  if (priv->bits == 5)
-    {
-                                       /* 0=5 bits */
-    }
-  else if (priv->bits == 6)
-    {
-      conf0 |= (1 << UART_BIT_NUM_S);  /* 1=6 bits */
-    }
-  else if (priv->bits == 7)
-    {
-      conf0 |= (2 << UART_BIT_NUM_S);  /* 2=7 bits */
-    }
-  else /* if (priv->bits == 8) */
-    {
-      conf0 |= (3 << UART_BIT_NUM_S);  /* 3=8 bits */
-    }
+/****************************************************************************
+ * Name: esp32_setfifoconf
+ *
+ * Description:
+ *   Program the RX full threshold, the RX timeout, the TX empty threshold
+ *   and the RX flow control (RTS) threshold into CONF1.
+ *
+ ****************************************************************************/
 
-  /* OR in settings for the selected parity */
+static void esp32_setfifoconf(struct esp32_dev_s *priv, uint8_t rxfull,
+                              uint8_t rxtout)
+{
+  uint32_t regval;
 
-  if (priv->parity == 1)
-    {
-      conf0 |= UART_PARITY_EN;
-    }
-  else if (priv->parity == 2)
+  regval = ((uint32_t)rxfull << UART_RXFIFO_FULL_THRHD_S) |
+           ((uint32_t)priv->txempty << UART_TXFIFO_EMPTY_THRHD_S);
+
+  if (rxtout > 0)
     {
-      conf0 |= UART_PARITY_EN | UART_PARITY;
+      regval |= ((uint32_t)rxtout << UART_RX_TOUT_THRHD_S) | UART_RX_TOUT_EN;
     }
 
-  /* OR in settings for the number of stop bits */
+  regval |= esp32_rxflowconf(priv);
+  esp32_serialout(priv, UART_CONF1_OFFSET, regval);
 
-  if (priv->stopbits2)
-    {
-      conf0 |= 3 << UART_STOP_BIT_NUM_S;
-    }
-  else
-    {
-      conf0 |= 1 << UART_STOP_BIT_NUM_S;
-    }
+#ifdef CONFIG_ESP32_UART_ADAPTIVE
+  priv->currxfull = rxfull;
+  priv->currxtout = rxtout;
+#endif
+}
 
-  /* Configure the UART BAUD */
+/****************************************************************************
+ * Name: esp32_setbaud
+ *
+ * Description:
+ *   Program the divider for priv->baud.  CLKDIV may be rewritten while the
+ *   UART is running;  the new rate applies from the next bit.
+ *
+ ****************************************************************************/
+
+static void esp32_setbaud(struct esp32_dev_s *priv)
+{
+  uint32_t clkdiv;
+  uint32_t regval;
 
   clkdiv  = (UART_CLK_FREQ << 4) / priv->baud;
 
   regval  = (clkdiv >> 4) << UART_CLKDIV_S;
   regval |= (clkdiv & 15) << UART_CLKDIV_FRAG_S;
   esp32_serialout(priv, UART_CLKDIV_OFFSET, regval);
+}
 
-  /* Configure UART pins
-   *
-   * Internal signals can be output to multiple GPIO pads.
-   * But only one GPIO pad can connect with input signal
-   */
-
-  esp32_configgpio(priv->config->txpin, OUTPUT_FUNCTION_2);
-  gpio_matrix_out(priv->config->txpin, priv->config->txsig, 0, 0);
+#ifdef CONFIG_ESP32_UART_AUTOBAUD
+/****************************************************************************
+ * Name: esp32_autobaud_start
+ *
+ * Description:
+ *   Restart baud rate detection.  Restarting clears the pulse and edge
+ *   counters.  The frame errors caused by a mismatched rate raise the
+ *   interrupts that poll the detection.
+ *
+ ****************************************************************************/
 
-  esp32_configgpio(priv->config->rxpin, INPUT_FUNCTION_2);
-  gpio_matrix_in(priv->config->rxpin, priv->config->rxsig, 0);
+static void esp32_autobaud_start(struct esp32_dev_s *priv)
+{
+  irqstate_t flags;
+  uint32_t regval;
 
-#if defined(CONFIG_SERIAL_IFLOWCONTROL) || defined(CONFIG_SERIAL_OFLOWCONTROL)
-  esp32_configgpio(priv->config->rtspin, OUTPUT_FUNCTION_2);
-  gpio_matrix_out(priv->config->rtspin, priv->config->rtssig, 0, 0);
+  flags = enter_critical_section();
 
-  esp32_configgpio(priv->config->ctspin, INPUT_FUNCTION_2);
-  gpio_matrix_in(priv->config->ctspin, priv->config->ctssig, 0);
-#endif
+  regval = esp32_serialin(priv, UART_AUTOBAUD_OFFSET) & ~UART_AUTOBAUD_EN;
+  esp32_serialout(priv, UART_AUTOBAUD_OFFSET, regval);
+  esp32_serialout(priv, UART_AUTOBAUD_OFFSET, regval | UART_AUTOBAUD_EN);
+  priv->autobaud = true;
 
-  /* Enable RX and error interrupts.  Clear and pending interrtupt */
+  leave_critical_section(flags);
+}
 
-  regval = UART_RXFIFO_FULL_INT_ENA | UART_FRM_ERR_INT_ENA |
-           UART_RXFIFO_TOUT_INT_ENA;
-  esp32_serialout(priv, UART_INT_ENA_OFFSET, regval);
+/****************************************************************************
+ * Name: esp32_autobaud_stop
+ *
+ * Description:
+ *   End baud rate detection.
+ *
+ ****************************************************************************/
 
-  esp32_serialout(priv, UART_INT_CLR_OFFSET, 0xffffffff);
+static void esp32_autobaud_stop(struct esp32_dev_s *priv)
+{
+  irqstate_t flags;
+  uint32_t regval;
 
-  /* Configure and enable the UART */
+  flags = enter_critical_section();
 
-  esp32_serialout(priv, UART_CONF0_OFFSET, conf0);
-  regval = (112 << UART_RXFIFO_FULL_THRHD_S) |
-           (0x02 << UART_RX_TOUT_THRHD_S) |
-            UART_RX_TOUT_EN;
-  esp32_serialout(priv, UART_CONF1_OFFSET, regval);
-#endif
+  regval = esp32_serialin(priv, UART_AUTOBAUD_OFFSET);
+  esp32_serialout(priv, UART_AUTOBAUD_OFFSET, regval & ~UART_AUTOBAUD_EN);
+  priv->autobaud = false;
 
-  return OK;
+  leave_critical_section(flags);
 }
 
 /****************************************************************************
- * Name: esp32_shutdown
+ * Name: esp32_autobaud_poll
  *
  * Description:
- *   Disable the UART.  This method is called when the serial port is
- *   closed.  It is assumed that esp32_detach was called earlier in the
- *   shutdown sequence.
+ *   Once enough RXD edges have been seen, compute the rate from the pulse
+ *   counters, program it and end the detection.  Characters received at
+ *   the wrong rate are never stored in the receive buffer (see
+ *   esp32_rxburst() and esp32_dma_rxdrain()); those still in the RX FIFO
+ *   or in the Rx descriptors are discarded here.  Called from the UART
+ *   interrupt and from TIOCGAUTOBAUD.
  *
  ****************************************************************************/
 
-static void esp32_shutdown(struct uart_dev_s *dev)
+static void esp32_autobaud_poll(struct uart_dev_s *dev)
 {
   struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+  irqstate_t flags;
+  uint32_t edges;
+  uint32_t baud;
+  uint32_t conf0;
 
-  /* Disable all UART interrupts */
+  flags = enter_critical_section();
 
-  esp32_disableallints(priv, NULL);
+  edges = esp32_serialin(priv, UART_RXD_CNT_OFFSET) & UART_RXD_EDGE_CNT_M;
+  if (!priv->autobaud || edges < CONFIG_ESP32_UART_AUTOBAUD_EDGES)
+    {
+      leave_critical_section(flags);
+      return;
+    }
 
-  /* Revert pins to inputs and detach UART signals */
+  baud = esp32_autobaud_rate(UART_CLK_FREQ,
+                             esp32_serialin(priv, UART_LOWPULSE_OFFSET),
+                             esp32_serialin(priv, UART_HIGHPULSE_OFFSET));
+  if (baud > 0)
+    {
+      /* recv.tail belongs to the reader so only the hardware is flushed */
 
-  esp32_configgpio(priv->config->txpin, INPUT);
-  gpio_matrix_out(MATRIX_DETACH_OUT_SIG, priv->config->txsig, true, false);
+#ifdef CONFIG_ESP32_UART_DMA
+      if (priv->dma != NULL)
+        {
+          esp32_dma_rxdrain(dev);
+        }
+      else
+#endif
+        {
+          conf0 = esp32_serialin(priv, UART_CONF0_OFFSET);
+          esp32_serialout(priv, UART_CONF0_OFFSET, conf0 | UART_RXFIFO_RST);
+          esp32_serialout(priv, UART_CONF0_OFFSET, conf0);
+        }
 
-  esp32_configgpio(priv->config->rxpin, INPUT);
-  gpio_matrix_in(MATRIX_DETACH_IN_LOW_PIN, priv->config->rxsig, false);
+      priv->baud = baud;
+      esp32_setbaud(priv);
+      esp32_autobaud_stop(priv);
+    }
 
-#if defined(CONFIG_SERIAL_IFLOWCONTROL) || defined(CONFIG_SERIAL_OFLOWCONTROL)
-  esp32_configgpio(priv->config->rtspin, INPUT);
-  gpio_matrix_out(MATRIX_DETACH_OUT_SIG, priv->config->rtssig, true, false);
+  leave_critical_section(flags);
+}
+#endif /* CONFIG_ESP32_UART_AUTOBAUD */
 
-  esp32_configgpio(priv->config->ctspin, INPUT);
-  gpio_matrix_in(MATRIX_DETACH_IN_LOW_PIN, priv->config->ctssig, false);
+#ifdef CONFIG_ESP32_UART_ADAPTIVE
+/****************************************************************************
+ * Name: esp32_adapt
+ *
+ * Description:
+ *   Called from the RX interrupt with the number of bytes just received.
+ *   Once per CONFIG_ESP32_UART_ADAPTIVE_INTERVAL ticks, the load of the
+ *   line (bytes received against what the baud rate could carry) sets the
+ *   RX timeout between the configured value (quiet line, low latency) and
+ *   CONFIG_ESP32_UART_ADAPTIVE_MAXTOUT (busy line, gaps within the stream
+ *   no longer cost an interrupt each).  An RX FIFO overflow lowers the RX
+ *   full threshold to leave more time to service the interrupt;  the
+ *   configured threshold is restored once the line is quiet again.
+ *
+ ****************************************************************************/
+
+static void esp32_adapt(struct esp32_dev_s *priv, unsigned int count,
+                        uint32_t intst)
+{
+  systime_t now = clock_systimer();
+  systime_t elapsed;
+  uint64_t capacity;
+  uint32_t load;
+  uint8_t rxfull = priv->currxfull;
+  uint8_t rxtout = priv->currxtout;
+  unsigned int symbits;
+
+  priv->rxbytes += count;
+
+  if ((intst & UART_RXFIFO_OVF_INT_ST) != 0 && rxfull > UART_ADAPT_MINFULL)
+    {
+      rxfull = (rxfull > UART_ADAPT_MINFULL + UART_ADAPT_STEP) ?
+               rxfull - UART_ADAPT_STEP : UART_ADAPT_MINFULL;
+    }
+
+  elapsed = now - priv->rxstart;
+  if (elapsed >= CONFIG_ESP32_UART_ADAPTIVE_INTERVAL)
+    {
+      /* Symbol length:  Start bit, data bits, parity bit and stop bits */
+
+      symbits  = 2 + priv->bits + (priv->parity != 0 ? 1 : 0) +
+                 (priv->stopbits2 ? 1 : 0);
+      capacity = ((uint64_t)priv->baud * elapsed * CONFIG_USEC_PER_TICK) /
+                 (1000000ull * symbits);
+
+      load = 100;
+      if (capacity > priv->rxbytes)
+        {
+          load = (uint32_t)(((uint64_t)priv->rxbytes * 100) / capacity);
+        }
+
+      if (priv->rxtout > 0 &&
+          priv->rxtout < CONFIG_ESP32_UART_ADAPTIVE_MAXTOUT)
+        {
+          rxtout = priv->rxtout +
+                   ((CONFIG_ESP32_UART_ADAPTIVE_MAXTOUT - priv->rxtout) *
+                    load) / 100;
+        }
+
+      if (load < 25)
+        {
+          rxfull = priv->rxfull;
+        }
+
+      priv->rxbytes = 0;
+      priv->rxstart = now;
+    }
+
+  if (rxfull != priv->currxfull || rxtout != priv->currxtout)
+    {
+      esp32_setfifoconf(priv, rxfull, rxtout);
+    }
+}
 #endif
 
-  /* Unconfigure and disable the UART */
+#ifdef CONFIG_ESP32_UART_RS485
+/****************************************************************************
+ * Name: esp32_rs485_config
+ *
+ * Description:
+ *   Apply the RS-485 configuration:  Route the RTS signal to the driver
+ *   enable pin with the requested polarity, released, and enable the RS-485
+ *   mode of the UART.  Interrupts must be disabled.
+ *
+ ****************************************************************************/
 
-  esp32_serialout(priv, UART_CONF0_OFFSET, 0);
-  esp32_serialout(priv, UART_CONF1_OFFSET, 0);
+static void esp32_rs485_config(struct esp32_dev_s *priv)
+{
+  uint32_t regval;
+  bool invert;
 
-  esp32_serialout(priv, UART_INT_ENA_OFFSET, 0);
-  esp32_serialout(priv, UART_INT_CLR_OFFSET, 0xffffffff);
+  /* Hand RTS to or back from the receiver */
+
+  regval = esp32_serialin(priv, UART_CONF1_OFFSET);
+  regval &= ~(UART_RX_FLOW_EN | UART_RX_FLOW_THRHD_M);
+  esp32_serialout(priv, UART_CONF1_OFFSET, regval | esp32_rxflowconf(priv));
+
+  regval = esp32_serialin(priv, UART_CONF0_OFFSET);
+
+  if ((priv->rs485.flags & SER_RS485_ENABLED) == 0)
+    {
+      esp32_serialout(priv, UART_RS485_CONF_OFFSET, 0);
+      esp32_serialout(priv, UART_CONF0_OFFSET, regval & ~UART_SW_RTS);
+      priv->txactive = false;
+      return;
+    }
+
+  /* SW_RTS set drives the RTS output low.  It is asserted (SW_RTS clear,
+   * RTS high) while sending;  invert it if the driver enable is active low.
+   */
+
+  esp32_serialout(priv, UART_CONF0_OFFSET, regval | UART_SW_RTS);
+  priv->txactive = false;
+
+  invert = (priv->rs485.flags & SER_RS485_RTS_ON_SEND) == 0;
+  esp32_configgpio(priv->config->depin, OUTPUT_FUNCTION_2);
+  gpio_matrix_out(priv->config->depin, priv->config->desig, invert, 0);
+
+  /* Do not hold off transmission while the receiver is busy (the bus is
+   * half duplex and the receiver sees our own data).  Loop back the
+   * transmitter only if the caller wants to receive its own data.
+   */
+
+  regval = UART_RS485_EN | UART_RS485RXBY_TX_EN;
+  if ((priv->rs485.flags & SER_RS485_RX_DURING_TX) != 0)
+    {
+      regval |= UART_RS485TX_RX_EN;
+    }
+
+  esp32_serialout(priv, UART_RS485_CONF_OFFSET, regval);
 }
 
 /****************************************************************************
- * Name: esp32_attach
+ * Name: esp32_rs485_txon
  *
  * Description:
- *   Configure the UART to operation in interrupt driven mode.  This method is
- *   called when the serial port is opened.  Normally, this is just after the
- *   the setup() method is called, however, the serial console may operate in
- *   a non-interrupt driven mode during the boot phase.
+ *   Assert the driver enable before a transmission and enable the TX_DONE
+ *   interrupt that will release it.  Interrupts must be disabled.
  *
- *   RX and TX interrupts are not enabled when by the attach method (unless the
- *   hardware supports multiple levels of interrupt enabling).  The RX and TX
- *   interrupts are not enabled until the txint() and rxint() methods are called.
+ * Returned Value:
+ *   True if the driver enable was just asserted and the caller must wait
+ *   for the delay before send, with interrupts enabled, before sending.
  *
  ****************************************************************************/
 
-static int esp32_attach(struct uart_dev_s *dev)
+static bool esp32_rs485_txon(struct esp32_dev_s *priv)
+{
+  uint32_t regval;
+
+  if ((priv->rs485.flags & SER_RS485_ENABLED) == 0 || priv->txactive)
+    {
+      return false;
+    }
+
+  regval = esp32_serialin(priv, UART_CONF0_OFFSET);
+  esp32_serialout(priv, UART_CONF0_OFFSET, regval & ~UART_SW_RTS);
+  priv->txactive = true;
+
+  esp32_serialout(priv, UART_INT_CLR_OFFSET, UART_TX_DONE_INT_CLR);
+  esp32_modifyint(priv, 0, UART_TX_DONE_INT_ENA);
+
+  return priv->rs485.delay_rts_before_send > 0;
+}
+
+/****************************************************************************
+ * Name: esp32_rs485_txoff
+ *
+ * Description:
+ *   Release the driver enable if nothing is left to send.  Interrupts must
+ *   be disabled.
+ *
+ ****************************************************************************/
+
+static void esp32_rs485_txoff(struct uart_dev_s *dev)
 {
   struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
-  int cpu;
-  int ret = OK;
+  uint32_t regval;
 
-  /* Allocate a level-sensitive, priority 1 CPU interrupt for the UART */
+  if (!priv->txactive || dev->xmit.head != dev->xmit.tail)
+    {
+      return;
+    }
 
-  priv->cpuint = esp32_alloc_levelint(1);
-  if (priv->cpuint < 0)
+#ifdef CONFIG_ESP32_UART_DMA
+  if (priv->dma != NULL && priv->dma->txlen > 0)
     {
-      ret = priv->cpuint;
+      return;
     }
+#endif
 
-  /* Set up to receive peripheral interrupts on the current CPU */
+  regval = esp32_serialin(priv, UART_STATUS_OFFSET);
+  if ((regval & UART_TXFIFO_CNT_M) != 0)
+    {
+      return;
+    }
 
-#ifdef CONFIG_SMP
-  cpu = up_cpu_index();
-#else
-  cpu = 0;
-#endif
+  esp32_modifyint(priv, UART_TX_DONE_INT_ENA, 0);
+
+  regval = esp32_serialin(priv, UART_CONF0_OFFSET);
+  esp32_serialout(priv, UART_CONF0_OFFSET, regval | UART_SW_RTS);
+  priv->txactive = false;
+}
 
-  /* Attach the GPIO peripheral to the allocated CPU interrupt */
+/****************************************************************************
+ * Name: esp32_rs485_timeout
+ *
+ * Description:
+ *   Watchdog handler ending the delay after send.
+ *
+ ****************************************************************************/
 
-  up_disable_irq(priv->cpuint);
-  esp32_attach_peripheral(cpu, priv->config->periph, priv->cpuint);
+static void esp32_rs485_timeout(int argc, wdparm_t arg, ...)
+{
+  struct uart_dev_s *dev = (struct uart_dev_s *)arg;
+  irqstate_t flags;
 
-  /* Attach and enable the IRQ */
+  flags = enter_critical_section();
+  esp32_rs485_txoff(dev);
+  leave_critical_section(flags);
+}
 
-  ret = irq_attach(priv->config->irq, priv->config->handler);
-  if (ret == OK)
+/****************************************************************************
+ * Name: esp32_rs485_txdone
+ *
+ * Description:
+ *   Called from the UART interrupt on TX_DONE:  The last stop bit has been
+ *   sent.  Release the driver enable now or after the delay after send.
+ *
+ ****************************************************************************/
+
+static void esp32_rs485_txdone(struct uart_dev_s *dev)
+{
+  struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+
+  if (priv->rs485.delay_rts_after_send > 0 && priv->rs485wd != NULL)
     {
-      /* Enable the CPU interrupt (RX and TX interrupts are still disabled
-       * in the UART
-       */
+      (void)wd_start(priv->rs485wd,
+                     MSEC2TICK(priv->rs485.delay_rts_after_send),
+                     (wdentry_t)esp32_rs485_timeout, 1, (wdparm_t)dev);
+    }
+  else
+    {
+      esp32_rs485_txoff(dev);
+    }
+}
+#endif /* CONFIG_ESP32_UART_RS485 */
+
+/****************************************************************************
+ * Name: esp32_disableallints
+ ****************************************************************************/
+
+static void esp32_disableallints(struct esp32_dev_s *priv, uint32_t *intena)
+{
+  irqstate_t flags;
+
+  /* The following must be atomic */
+
+  flags = esp32_intlock(priv);
 
-      up_enable_irq(priv->cpuint);
+  if (intena)
+    {
+      /* Return the current interrupt mask */
+
+      *intena = esp32_serialin(priv, UART_INT_ENA_OFFSET);
     }
 
-  return ret;
+  /* Disable all interrupts */
+
+  esp32_serialout(priv, UART_INT_ENA_OFFSET, 0);
+  esp32_intunlock(priv, flags);
 }
 
+#ifdef CONFIG_ESP32_UART_DMA
 /****************************************************************************
- * Name: esp32_detach
+ * Name: esp32_dmain
+ ****************************************************************************/
+
+static inline uint32_t esp32_dmain(struct esp32_dma_s *dma, int offset)
+{
+  return getreg32(dma->uhcibase + offset);
+}
+
+/****************************************************************************
+ * Name: esp32_dmaout
+ ****************************************************************************/
+
+static inline void esp32_dmaout(struct esp32_dma_s *dma, int offset,
+                                uint32_t value)
+{
+  putreg32(value, dma->uhcibase + offset);
+}
+
+/****************************************************************************
+ * Name: esp32_ringput
  *
  * Description:
- *   Detach UART interrupts.  This method is called when the serial port is
- *   closed normally just before the shutdown method is called.  The exception
- *   is the serial console which is never shutdown.
+ *   Copy up to 'len' bytes into a serial buffer, in at most two pieces.
+ *   Returns the number of bytes copied, which is less than 'len' only if
+ *   the buffer became full.
  *
  ****************************************************************************/
 
-static void esp32_detach(struct uart_dev_s *dev)
+static size_t esp32_ringput(struct uart_buffer_s *buf, const uint8_t *src,
+                            size_t len)
+{
+  size_t nput = 0;
+  size_t span;
+  int16_t head = buf->head;
+  int16_t tail;
+
+  while (nput < len)
+    {
+      /* One slot is always left empty to distinguish full from empty */
+
+      tail = buf->tail;
+      if (head < tail)
+        {
+          span = tail - head - 1;
+        }
+      else
+        {
+          span = buf->size - head - (tail == 0 ? 1 : 0);
+        }
+
+      if (span == 0)
+        {
+          break;
+        }
+
+      if (span > len - nput)
+        {
+          span = len - nput;
+        }
+
+      memcpy(&buf->buffer[head], &src[nput], span);
+      nput += span;
+      head += span;
+      if (head >= buf->size)
+        {
+          head = 0;
+        }
+    }
+
+  buf->head = head;
+  return nput;
+}
+
+/****************************************************************************
+ * Name: esp32_dma_setup
+ *
+ * Description:
+ *   Enable the UHCI engine serving this UART, connect it to the UART and
+ *   start the in link ring.  Interrupts must be disabled.
+ *
+ ****************************************************************************/
+
+static void esp32_dma_setup(struct uart_dev_s *dev)
 {
   struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
-  int cpu;
+  struct esp32_dma_s *dma = priv->dma;
+  uint32_t clken;
+  uint32_t rst;
+  int i;
+
+  if (dma->uhcibase == DR_REG_UHCI0_BASE)
+    {
+      clken = DPORT_UHCI0_CLK_EN;
+      rst   = DPORT_UHCI0_RST;
+    }
+  else
+    {
+      clken = DPORT_UHCI1_CLK_EN;
+      rst   = DPORT_UHCI1_RST;
+    }
+
+  /* Enable the UHCI clock and release the UHCI from reset */
+
+  modifyreg32(DPORT_PERIP_CLK_EN_REG, 0, clken);
+  modifyreg32(DPORT_PERIP_RST_EN_REG, rst, 0);
+
+  /* Reset the DMA state machines.  Then connect the UHCI to the UART with
+   * framing, escapes and checksums disabled so that data passes through
+   * unmodified and a frame ends whenever the line goes idle.
+   */
+
+  esp32_dmaout(dma, UHCI_CONF0_OFFSET,
+               UHCI_IN_RST | UHCI_OUT_RST | UHCI_AHBM_FIFO_RST |
+               UHCI_AHBM_RST);
+  esp32_dmaout(dma, UHCI_CONF0_OFFSET, 0);
+  esp32_dmaout(dma, UHCI_CONF0_OFFSET,
+               dma->uartce | UHCI_UART_IDLE_EOF_EN | UHCI_CLK_EN);
+  esp32_dmaout(dma, UHCI_CONF1_OFFSET, 0);
+  esp32_dmaout(dma, UHCI_ESCAPE_CONF_OFFSET, 0);
+
+  /* Build the ring of Rx descriptors, all owned by the DMA */
+
+  for (i = 0; i < UART_DMA_NRXDESC; i++)
+    {
+      dma->rxdesc[i].ctrl = DMA_DESC_OWNER |
+                            (UART_DMA_RXSIZE << DMA_DESC_SIZE_S);
+      dma->rxdesc[i].buf  = (FAR uint8_t *)dma->rxbuffer[i];
+      dma->rxdesc[i].next = &dma->rxdesc[(i + 1) % UART_DMA_NRXDESC];
+    }
+
+  dma->rxnext    = 0;
+  dma->rxoffset  = 0;
+  dma->rxstalled = false;
+  dma->txlen     = 0;
+
+  /* Enable completion interrupts and start receiving */
+
+  esp32_dmaout(dma, UHCI_INT_CLR_OFFSET, 0xffffffff);
+  esp32_dmaout(dma, UHCI_INT_ENA_OFFSET, UART_DMA_RXINTS | UART_DMA_TXINTS);
+  esp32_dmaout(dma, UHCI_DMA_IN_LINK_OFFSET,
+               ((uint32_t)dma->rxdesc & UHCI_INLINK_ADDR_M) |
+               UHCI_INLINK_START);
+}
+
+/****************************************************************************
+ * Name: esp32_dma_shutdown
+ *
+ * Description:
+ *   Stop both links and disable UHCI interrupts.  Data still in the Rx
+ *   descriptors is discarded; a transfer in flight is abandoned and its
+ *   data left in the transmit buffer.
+ *
+ ****************************************************************************/
+
+static void esp32_dma_shutdown(struct uart_dev_s *dev)
+{
+  struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+  struct esp32_dma_s *dma = priv->dma;
+
+  esp32_dmaout(dma, UHCI_INT_ENA_OFFSET, 0);
+  esp32_dmaout(dma, UHCI_DMA_IN_LINK_OFFSET, UHCI_INLINK_STOP);
+  esp32_dmaout(dma, UHCI_DMA_OUT_LINK_OFFSET, UHCI_OUTLINK_STOP);
+  esp32_dmaout(dma, UHCI_INT_CLR_OFFSET, 0xffffffff);
+
+  dma->txlen = 0;
+}
+
+/****************************************************************************
+ * Name: esp32_dma_rxdrain
+ *
+ * Description:
+ *   Pass the data of each completed Rx descriptor to the receive buffer
+ *   and hand the descriptor back to the DMA.  During baud rate detection,
+ *   the data is discarded instead.  If the receive buffer fills,
+ *   the remaining descriptors are held and the DMA stalls until the reader
+ *   makes room and re-enables Rx interrupts.  Meanwhile, the UART RX FIFO
+ *   fills:  With flow control enabled, RTS then holds off the sender;
+ *   otherwise, further data overflows the FIFO and is counted as an RX
+ *   overflow.  Interrupts must be disabled.
+ *
+ ****************************************************************************/
+
+static void esp32_dma_rxdrain(struct uart_dev_s *dev)
+{
+  struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+  struct esp32_dma_s *dma = priv->dma;
+  struct esp32_dmadesc_s *desc;
+  uint32_t ctrl;
+  size_t len;
+  size_t nput;
+  bool received = false;
+  bool returned = false;
+
+  for (; ; )
+    {
+      desc = &dma->rxdesc[dma->rxnext];
+      ctrl = desc->ctrl;
+      if ((ctrl & DMA_DESC_OWNER) != 0)
+        {
+          break;
+        }
+
+      len  = (ctrl & DMA_DESC_LENGTH_M) >> DMA_DESC_LENGTH_S;
+
+#ifdef CONFIG_ESP32_UART_AUTOBAUD
+      if (priv->autobaud)
+        {
+          nput = len - dma->rxoffset;
+
+#ifdef CONFIG_ESP32_UART_STATS
+          priv->stats.rxdropped += nput;
+#endif
+        }
+      else
+#endif
+        {
+          nput = esp32_ringput(&dev->recv, &desc->buf[dma->rxoffset],
+                               len - dma->rxoffset);
+          received |= (nput > 0);
+
+#ifdef CONFIG_ESP32_UART_STATS
+          priv->stats.rxbytes += nput;
+#endif
+        }
+
+      dma->rxoffset += nput;
+
+      if (dma->rxoffset < len)
+        {
+          /* The receive buffer is full */
+
+          break;
+        }
+
+      /* Return the descriptor to the DMA */
+
+      desc->ctrl    = DMA_DESC_OWNER | (UART_DMA_RXSIZE << DMA_DESC_SIZE_S);
+      dma->rxoffset = 0;
+      dma->rxnext   = (dma->rxnext + 1) % UART_DMA_NRXDESC;
+      returned      = true;
+    }
+
+  if (returned && dma->rxstalled)
+    {
+      dma->rxstalled = false;
+      esp32_dmaout(dma, UHCI_DMA_IN_LINK_OFFSET, UHCI_INLINK_RESTART);
+    }
+
+  if (received)
+    {
+      uart_datareceived(dev);
+    }
+}
+
+/****************************************************************************
+ * Name: esp32_dma_txstart
+ *
+ * Description:
+ *   If the Tx DMA is idle, point the out link at the pending data in the
+ *   transmit buffer (two descriptors when the data wraps) and start it.
+ *   Interrupts must be disabled.
+ *
+ ****************************************************************************/
+
+static void esp32_dma_txstart(struct uart_dev_s *dev)
+{
+  struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+  struct esp32_dma_s *dma = priv->dma;
+  struct uart_buffer_s *xmit = &dev->xmit;
+  struct esp32_dmadesc_s *desc = dma->txdesc;
+  int16_t head = xmit->head;
+  int16_t tail = xmit->tail;
+  uint32_t len0;
+  uint32_t len1;
+
+  if (dma->txlen > 0 || head == tail)
+    {
+      return;
+    }
+
+  if (head > tail)
+    {
+      len0 = head - tail;
+      len1 = 0;
+    }
+  else
+    {
+      len0 = xmit->size - tail;
+      len1 = head;
+    }
+
+  if (len0 > DMA_DESC_MAXSIZE)
+    {
+      len0 = DMA_DESC_MAXSIZE;
+      len1 = 0;
+    }
+  else if (len1 > DMA_DESC_MAXSIZE)
+    {
+      len1 = DMA_DESC_MAXSIZE;
+    }
+
+  desc[0].buf  = (FAR uint8_t *)&xmit->buffer[tail];
+  desc[0].next = NULL;
+  desc[0].ctrl = DMA_DESC_OWNER | DMA_DESC_EOF |
+                 (len0 << DMA_DESC_LENGTH_S) |
+                 (((len0 + 3) & ~3) << DMA_DESC_SIZE_S);
+
+  if (len1 > 0)
+    {
+      desc[1].buf   = (FAR uint8_t *)xmit->buffer;
+      desc[1].next  = NULL;
+      desc[1].ctrl  = DMA_DESC_OWNER | DMA_DESC_EOF |
+                      (len1 << DMA_DESC_LENGTH_S) |
+                      (((len1 + 3) & ~3) << DMA_DESC_SIZE_S);
+
+      desc[0].next  = &desc[1];
+      desc[0].ctrl &= ~DMA_DESC_EOF;
+    }
+
+  dma->txlen = len0 + len1;
+  esp32_dmaout(dma, UHCI_DMA_OUT_LINK_OFFSET,
+               ((uint32_t)desc & UHCI_OUTLINK_ADDR_M) | UHCI_OUTLINK_START);
+}
+#endif /* CONFIG_ESP32_UART_DMA */
+
+/****************************************************************************
+ * Name: esp32_setup
+ *
+ * Description:
+ *   Configure the UART baud, bits, parity, etc. This method is called the
+ *   first time that the serial port is opened.
+ *
+ ****************************************************************************/
+
+static int esp32_setup(struct uart_dev_s *dev)
+{
+  struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+#ifndef CONFIG_SUPPRESS_UART_CONFIG
+  uint32_t regval;
+  uint32_t conf0;
+
+  /* Note: The logic here depends on the fact that that the UART module
+   * was enabled and the pins were configured in esp32_lowsetup().
+   */
+
+  /* The shutdown method will put the UART in a known, disabled state */
+
+  esp32_shutdown(dev);
+
+  /* Set up the CONF0 register. */
+
+  conf0 = UART_TICK_REF_ALWAYS_ON;
+
+#if defined(CONFIG_SERIAL_IFLOWCONTROL) || defined(CONFIG_SERIAL_OFLOWCONTROL)
+  /* Check if flow control is enabled */
+
+  if (priv->flowc)
+    {
+      /* Enable hardware flow control */
+
+      conf0 |= UART_TX_FLOW_EN;
+    }
+#endif
+
+#ifdef CONFIG_ESP32_UART_RS485
+  /* In RS-485 mode the RTS signal is the driver enable.  SW_RTS set
+   * releases it (receive).
+   */
+
+  if ((priv->rs485.flags & SER_RS485_ENABLED) != 0)
+    {
+      conf0 |= UART_SW_RTS;
+    }
+#endif
+
+  /* OR in settings for the selected number of bits */
+
+  if (priv->bits == 5)
+    {
+                                       /* 0=5 bits */
+    }
+  else if (priv->bits == 6)
+    {
+      conf0 |= (1 << UART_BIT_NUM_S);  /* 1=6 bits */
+    }
+  else if (priv->bits == 7)
+    {
+      conf0 |= (2 << UART_BIT_NUM_S);  /* 2=7 bits */
+    }
+  else /* if (priv->bits == 8) */
+    {
+      conf0 |= (3 << UART_BIT_NUM_S);  /* 3=8 bits */
+    }
+
+  /* OR in settings for the selected parity */
+
+  if (priv->parity == 1)
+    {
+      conf0 |= UART_PARITY_EN;
+    }
+  else if (priv->parity == 2)
+    {
+      conf0 |= UART_PARITY_EN | UART_PARITY;
+    }
+
+  /* OR in settings for the number of stop bits */
+
+  if (priv->stopbits2)
+    {
+      conf0 |= 3 << UART_STOP_BIT_NUM_S;
+    }
+  else
+    {
+      conf0 |= 1 << UART_STOP_BIT_NUM_S;
+    }
+
+  /* Configure the UART BAUD */
+
+  esp32_setbaud(priv);
+
+  /* Configure UART pins
+   *
+   * Internal signals can be output to multiple GPIO pads.
+   * But only one GPIO pad can connect with input signal
+   */
+
+  esp32_configgpio(priv->config->txpin, OUTPUT_FUNCTION_2);
+  gpio_matrix_out(priv->config->txpin, priv->config->txsig, 0, 0);
+
+  esp32_configgpio(priv->config->rxpin, INPUT_FUNCTION_2);
+  gpio_matrix_in(priv->config->rxpin, priv->config->rxsig, 0);
+
+#if defined(CONFIG_SERIAL_IFLOWCONTROL) || defined(CONFIG_SERIAL_OFLOWCONTROL)
+  esp32_configgpio(priv->config->rtspin, OUTPUT_FUNCTION_2);
+  gpio_matrix_out(priv->config->rtspin, priv->config->rtssig, 0, 0);
+
+  esp32_configgpio(priv->config->ctspin, INPUT_FUNCTION_2);
+  gpio_matrix_in(priv->config->ctspin, priv->config->ctssig, 0);
+#endif
+
+  /* Enable RX and error interrupts.  Clear and pending interrtupt */
+
+  regval = UART_RXFIFO_FULL_INT_ENA | UART_ERR_INT_ENA |
+           UART_RXFIFO_TOUT_INT_ENA | UART_RXFIFO_OVF_INT_ENA;
+
+#ifdef CONFIG_ESP32_UART_DMA
+  if (priv->dma != NULL)
+    {
+      /* The UHCI drains the RX FIFO:  Only errors and RX FIFO overflows
+       * (when the DMA stalls) interrupt the UART.  A receive frame ends
+       * after CONFIG_ESP32_UART_DMA_RXIDLE idle bits and no idle time is
+       * inserted between transmit frames.
+       */
+
+      regval = UART_ERR_INT_ENA | UART_RXFIFO_OVF_INT_ENA;
+      esp32_serialout(priv, UART_IDLE_CONF_OFFSET,
+                      (10 << UART_TX_BRK_NUM_S) |
+                      (CONFIG_ESP32_UART_DMA_RXIDLE << UART_RX_IDLE_THRHD_S));
+    }
+#endif
+
+#ifdef CONFIG_ESP32_UART_PATTERN
+  if (priv->pattern)
+    {
+      regval |= UART_AT_CMD_CHAR_DET_INT_ENA;
+    }
+#endif
+
+  esp32_serialout(priv, UART_INT_ENA_OFFSET, regval);
+
+  esp32_serialout(priv, UART_INT_CLR_OFFSET, 0xffffffff);
+
+  /* Configure and enable the UART */
+
+  esp32_serialout(priv, UART_CONF0_OFFSET, conf0);
+  esp32_setfifoconf(priv, priv->rxfull, priv->rxtout);
+
+#ifdef CONFIG_ESP32_UART_RS485
+  esp32_rs485_config(priv);
+#endif
+
+#ifdef CONFIG_ESP32_UART_DMA
+  if (priv->dma != NULL)
+    {
+      esp32_dma_setup(dev);
+    }
+#endif
+#endif
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: esp32_shutdown
+ *
+ * Description:
+ *   Disable the UART.  This method is called when the serial port is
+ *   closed.  It is assumed that esp32_detach was called earlier in the
+ *   shutdown sequence.
+ *
+ ****************************************************************************/
+
+static void esp32_shutdown(struct uart_dev_s *dev)
+{
+  struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+
+  /* Disable all UART interrupts */
+
+  esp32_disableallints(priv, NULL);
+
+#ifdef CONFIG_ESP32_UART_AUTOBAUD
+  esp32_autobaud_stop(priv);
+#endif
+
+#ifdef CONFIG_ESP32_UART_DMA
+  if (priv->dma != NULL)
+    {
+      esp32_dma_shutdown(dev);
+    }
+#endif
+
+  /* Revert pins to inputs and detach UART signals */
+
+  esp32_configgpio(priv->config->txpin, INPUT);
+  gpio_matrix_out(MATRIX_DETACH_OUT_SIG, priv->config->txsig, true, false);
+
+  esp32_configgpio(priv->config->rxpin, INPUT);
+  gpio_matrix_in(MATRIX_DETACH_IN_LOW_PIN, priv->config->rxsig, false);
+
+#if defined(CONFIG_SERIAL_IFLOWCONTROL) || defined(CONFIG_SERIAL_OFLOWCONTROL)
+  esp32_configgpio(priv->config->rtspin, INPUT);
+  gpio_matrix_out(MATRIX_DETACH_OUT_SIG, priv->config->rtssig, true, false);
+
+  esp32_configgpio(priv->config->ctspin, INPUT);
+  gpio_matrix_in(MATRIX_DETACH_IN_LOW_PIN, priv->config->ctssig, false);
+#endif
+
+#ifdef CONFIG_ESP32_UART_RS485
+  if ((priv->rs485.flags & SER_RS485_ENABLED) != 0)
+    {
+      esp32_configgpio(priv->config->depin, INPUT);
+      gpio_matrix_out(MATRIX_DETACH_OUT_SIG, priv->config->desig, true,
+                      false);
+    }
+
+  priv->txactive = false;
+  esp32_serialout(priv, UART_RS485_CONF_OFFSET, 0);
+#endif
+
+  /* Unconfigure and disable the UART */
+
+  esp32_serialout(priv, UART_CONF0_OFFSET, 0);
+  esp32_serialout(priv, UART_CONF1_OFFSET, 0);
+
+  esp32_serialout(priv, UART_INT_ENA_OFFSET, 0);
+  esp32_serialout(priv, UART_INT_CLR_OFFSET, 0xffffffff);
+}
+
+/****************************************************************************
+ * Name: esp32_attach
+ *
+ * Description:
+ *   Configure the UART to operation in interrupt driven mode.  This method is
+ *   called when the serial port is opened.  Normally, this is just after the
+ *   the setup() method is called, however, the serial console may operate in
+ *   a non-interrupt driven mode during the boot phase.
+ *
+ *   RX and TX interrupts are not enabled when by the attach method (unless the
+ *   hardware supports multiple levels of interrupt enabling).  The RX and TX
+ *   interrupts are not enabled until the txint() and rxint() methods are called.
+ *
+ ****************************************************************************/
+
+static int esp32_attach(struct uart_dev_s *dev)
+{
+  struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+  int cpu;
+  int ret;
+
+  /* Attach the IRQ */
+
+  ret = irq_attach(priv->config->irq, priv->config->handler);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Set up to receive peripheral interrupts on the current CPU */
+
+#ifdef CONFIG_SMP
+  cpu = up_cpu_index();
+#else
+  cpu = 0;
+#endif
+
+  /* Attach the UART peripheral to a level-sensitive, priority 1 CPU
+   * interrupt.  All UARTs share one CPU interrupt:  Each UART handler is
+   * called only when its own peripheral interrupt is pending.  RX and TX
+   * interrupts are still disabled in the UART.  The UART interrupt may
+   * later be moved to the other CPU by esp32_irq_setaffinity().
+   */
+
+  ret = esp32_setup_irq(cpu, priv->config->periph, 1,
+                        ESP32_CPUINT_FLAG_SHARED);
+  if (ret < 0)
+    {
+      irq_detach(priv->config->irq);
+      return ret;
+    }
+
+#ifdef CONFIG_ESP32_UART_DMA
+  /* The UHCI completion interrupt shares the same CPU interrupt */
+
+  if (priv->dma != NULL)
+    {
+      ret = irq_attach(priv->dma->irq, priv->dma->handler);
+      if (ret >= 0)
+        {
+          ret = esp32_setup_irq(cpu, priv->dma->periph, 1,
+                                ESP32_CPUINT_FLAG_SHARED);
+          if (ret < 0)
+            {
+              irq_detach(priv->dma->irq);
+            }
+        }
+
+      if (ret < 0)
+        {
+          esp32_teardown_irq(priv->config->periph);
+          irq_detach(priv->config->irq);
+          return ret;
+        }
+    }
+#endif
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: esp32_detach
+ *
+ * Description:
+ *   Detach UART interrupts.  This method is called when the serial port is
+ *   closed normally just before the shutdown method is called.  The exception
+ *   is the serial console which is never shutdown.
+ *
+ ****************************************************************************/
+
+static void esp32_detach(struct uart_dev_s *dev)
+{
+  struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+
+  /* Disassociate the peripheral interrupt from whichever CPU currently
+   * receives it and release the CPU interrupt.
+   */
+
+#ifdef CONFIG_ESP32_UART_DMA
+  if (priv->dma != NULL)
+    {
+      esp32_teardown_irq(priv->dma->periph);
+      irq_detach(priv->dma->irq);
+    }
+#endif
+
+  esp32_teardown_irq(priv->config->periph);
+  irq_detach(priv->config->irq);
+}
+
+/****************************************************************************
+ * Name: esp32_rxburst
+ *
+ * Description:
+ *   Move 'count' bytes (the number reported by the RX FIFO count) from the
+ *   RX FIFO into the receive buffer.  The buffer indices are read and
+ *   written only once.  As in uart_recvchars(), bytes that do not fit in
+ *   the receive buffer are discarded.  So are all bytes received during
+ *   baud rate detection.
+ *
+ ****************************************************************************/
+
+static void esp32_rxburst(struct uart_dev_s *dev, unsigned int count)
+{
+  struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+  struct uart_buffer_s *recv = &dev->recv;
+  uint32_t fifo = priv->config->uartbase + UART_FIFO_OFFSET;
+  int16_t head = recv->head;
+  int16_t tail = recv->tail;
+  unsigned int room;
+  unsigned int i;
+  char ch;
+
+  /* This is the only writer of recv.head and the reader the only writer of
+   * recv.tail.  Do not store into slots the reader may still be reading.
+   */
+
+  xtensa_atomic_thread_fence(XTENSA_ATOMIC_ACQUIRE);
+
+  /* One slot is always left empty to distinguish full from empty */
+
+  room = (tail > head) ? tail - head - 1 : recv->size - head + tail - 1;
+
+#ifdef CONFIG_ESP32_UART_AUTOBAUD
+  /* Characters received at the wrong rate are of no use to the reader */
+
+  if (priv->autobaud)
+    {
+      room = 0;
+    }
+#endif
+
+  for (i = 0; i < count; i++)
+    {
+      ch = (char)(getreg32(fifo) & UART_RXFIFO_RD_BYTE_M);
+      if (i < room)
+        {
+          recv->buffer[head] = ch;
+          if (++head >= recv->size)
+            {
+              head = 0;
+            }
+        }
+    }
+
+  /* Publish the new characters only after they are stored */
+
+  xtensa_atomic_thread_fence(XTENSA_ATOMIC_RELEASE);
+  recv->head = head;
+
+#ifdef CONFIG_ESP32_UART_PATTERN
+  priv->rxin += count < room ? count : room;
+#endif
+
+#ifdef CONFIG_ESP32_UART_STATS
+  if (count > room)
+    {
+      priv->stats.rxbytes   += room;
+      priv->stats.rxdropped += count - room;
+    }
+  else
+    {
+      priv->stats.rxbytes   += count;
+    }
+#endif
+
+  /* Waking a reader is not lock-free:  sem_post() enters the global
+   * critical section.
+   */
+
+  if (count > 0 && room > 0)
+    {
+      uart_datareceived(dev);
+    }
+}
+
+#ifdef CONFIG_ESP32_UART_PATTERN
+/****************************************************************************
+ * Name: esp32_patterndet
+ *
+ * Description:
+ *   Called from the UART interrupt when the delimiter has been detected.
+ *   The delimiter is the last character received:  Move the RX FIFO into
+ *   the RX buffer and record where the frame ends.  If the queue is full
+ *   the frame is merged with the next one.
+ *
+ ****************************************************************************/
+
+static void esp32_patterndet(struct uart_dev_s *dev)
+{
+  struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+  uint32_t status;
+  unsigned int tail;
+
+  status = esp32_serialin(priv, UART_STATUS_OFFSET);
+  esp32_rxburst(dev, (status & UART_RXFIFO_CNT_M) >> UART_RXFIFO_CNT_S);
+
+  if (priv->patcount < CONFIG_ESP32_UART_PATTERN_QUEUE)
+    {
+      tail = priv->pathead + priv->patcount;
+      if (tail >= CONFIG_ESP32_UART_PATTERN_QUEUE)
+        {
+          tail -= CONFIG_ESP32_UART_PATTERN_QUEUE;
+        }
+
+      priv->patpos[tail] = priv->rxin;
+      priv->patcount++;
+    }
+}
+#endif
+
+/****************************************************************************
+ * Name: esp32_txburst
+ *
+ * Description:
+ *   Move as many bytes as fit in 'room' free TX FIFO entries from the
+ *   transmit buffer into the TX FIFO.  When the transmit buffer becomes
+ *   empty the TX interrupt is disabled.  Returns the number of bytes moved.
+ *
+ ****************************************************************************/
+
+static unsigned int esp32_txburst(struct uart_dev_s *dev, unsigned int room)
+{
+  struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+  struct uart_buffer_s *xmit = &dev->xmit;
+  uint32_t fifo = priv->config->uartbase + UART_FIFO_OFFSET;
+  int16_t head = xmit->head;
+  int16_t tail = xmit->tail;
+  unsigned int count;
+  unsigned int i;
+
+  /* This is the only writer of xmit.tail and the writer the only writer of
+   * xmit.head.  Read the characters only after reading the head.
+   */
+
+  xtensa_atomic_thread_fence(XTENSA_ATOMIC_ACQUIRE);
+
+  count = (head >= tail) ? head - tail : xmit->size - tail + head;
+  if (count > room)
+    {
+      count = room;
+    }
+
+  for (i = 0; i < count; i++)
+    {
+      putreg32((uint32_t)(uint8_t)xmit->buffer[tail], fifo);
+      if (++tail >= xmit->size)
+        {
+          tail = 0;
+        }
+    }
+
+#ifdef CONFIG_ESP32_UART_STATS
+  priv->stats.txbytes += count;
+#endif
+
+  /* Free the slots only after the characters are read */
+
+  xtensa_atomic_thread_fence(XTENSA_ATOMIC_RELEASE);
+  xmit->tail = tail;
+
+  /* When all of the characters have been sent from the buffer disable the
+   * TX interrupt.  The writer may have queued more and enabled it since the
+   * head was read:  Check again once it is disabled so that they are not
+   * stranded.
+   */
+
+  if (tail == head)
+    {
+      esp32_modifyint(priv, UART_TXFIFO_EMPTY_INT_ENA, 0);
+
+      xtensa_atomic_thread_fence(XTENSA_ATOMIC_ACQUIRE);
+      if (xmit->head != tail)
+        {
+          esp32_modifyint(priv, 0, UART_TXFIFO_EMPTY_INT_ENA);
+        }
+    }
+
+  if (count > 0)
+    {
+      uart_datasent(dev);
+    }
+
+  return count;
+}
+
+#ifdef CONFIG_ESP32_UART_STATS
+/****************************************************************************
+ * Name: esp32_errstats
+ *
+ * Description:
+ *   Count the receive errors flagged in the interrupt status.
+ *
+ ****************************************************************************/
+
+static inline void esp32_errstats(struct esp32_dev_s *priv, uint32_t intst)
+{
+  if ((intst & UART_RXFIFO_OVF_INT_ST) != 0)
+    {
+      priv->stats.rxoverflow++;
+    }
+
+  if ((intst & UART_FRM_ERR_INT_ST) != 0)
+    {
+      priv->stats.frameerr++;
+    }
+
+  if ((intst & UART_PARITY_ERR_INT_ST) != 0)
+    {
+      priv->stats.parityerr++;
+    }
+}
+#endif
+
+/****************************************************************************
+ * Name: esp32_interrupt
+ *
+ * Description:
+ *   This is the common UART interrupt handler.  It will be invoked
+ *   when an interrupt received on the device.  The interrupt status and
+ *   FIFO counts are read once per pass and whole FIFOs are then moved to
+ *   or from the serial buffers.
+ *
+ ****************************************************************************/
+
+static int esp32_interrupt(struct uart_dev_s *dev)
+{
+  struct esp32_dev_s *priv;
+  uint32_t intst;
+  uint32_t status;
+  unsigned int count;
+  int passes;
+  bool handled;
+
+  DEBUGASSERT(dev != NULL && dev->priv != NULL);
+  priv = (struct esp32_dev_s *)dev->priv;
+
+#ifdef CONFIG_ESP32_UART_STATS
+  priv->stats.interrupts++;
+#endif
+
+#ifdef CONFIG_ESP32_UART_AUTOBAUD
+  if (priv->autobaud)
+    {
+      esp32_autobaud_poll(dev);
+    }
+#endif
+
+#ifdef CONFIG_ESP32_UART_DMA
+  if (priv->dma != NULL)
+    {
+      /* Data is moved by the UHCI.  Only error, RX FIFO overflow (and
+       * RS-485 TX_DONE) interrupts come here.
+       */
+
+      priv->status = esp32_serialin(priv, UART_INT_ST_OFFSET);
+      esp32_serialout(priv, UART_INT_CLR_OFFSET, priv->status);
+
+#ifdef CONFIG_ESP32_UART_STATS
+      esp32_errstats(priv, priv->status);
+#endif
+
+#ifdef CONFIG_ESP32_UART_RS485
+      if ((priv->status & UART_TX_DONE_INT_ST) != 0)
+        {
+          irqstate_t flags = enter_critical_section();
+          esp32_rs485_txdone(dev);
+          leave_critical_section(flags);
+        }
+#endif
+
+      return OK;
+    }
+#endif
+
+  /* Loop until there are no characters to be transferred or, until we have
+   * been looping for a long time.
+   */
+
+  handled = true;
+  for (passes = 0; passes < 256 && handled; passes++)
+    {
+      handled      = false;
+      intst        = esp32_serialin(priv, UART_INT_ST_OFFSET);
+      status       = esp32_serialin(priv, UART_STATUS_OFFSET);
+      priv->status = intst;
+
+#ifdef CONFIG_ESP32_UART_STATS
+      priv->stats.passes++;
+      esp32_errstats(priv, intst);
+#endif
+
+      if ((intst & (UART_RXFIFO_FULL_INT_ST | UART_RXFIFO_TOUT_INT_ST |
+                    UART_RXFIFO_OVF_INT_ST)) != 0)
+        {
+          /* Drain everything in the RXFIFO */
+
+          count = (status & UART_RXFIFO_CNT_M) >> UART_RXFIFO_CNT_S;
+          if (count > 0)
+            {
+              esp32_rxburst(dev, count);
+              handled = true;
+            }
+
+#ifdef CONFIG_ESP32_UART_ADAPTIVE
+          if (priv->adaptive)
+            {
+              esp32_adapt(priv, count, intst);
+            }
+#endif
+        }
+
+#ifdef CONFIG_ESP32_UART_PATTERN
+      if ((intst & UART_AT_CMD_CHAR_DET_INT_ST) != 0)
+        {
+          esp32_patterndet(dev);
+        }
+#endif
+
+      if ((intst & UART_TXFIFO_EMPTY_INT_ST) != 0)
+        {
+          /* Refill the TXFIFO */
+
+          count = (status & UART_TXFIFO_CNT_M) >> UART_TXFIFO_CNT_S;
+          if (esp32_txburst(dev, UART_FIFO_SIZE - count) > 0)
+            {
+              handled = true;
+            }
+        }
+
+      /* Clear the interrupts just serviced.  The FIFO interrupts assert
+       * again if a FIFO is still beyond its threshold.
+       */
+
+      esp32_serialout(priv, UART_INT_CLR_OFFSET, intst);
+
+#ifdef CONFIG_ESP32_UART_RS485
+      if ((intst & UART_TX_DONE_INT_ST) != 0)
+        {
+          irqstate_t flags = enter_critical_section();
+          esp32_rs485_txdone(dev);
+          leave_critical_section(flags);
+        }
+#endif
+    }
+
+  return OK;
+}
+
+#ifdef CONFIG_ESP32_UART_DMA
+/****************************************************************************
+ * Name: esp32_dma_interrupt
+ *
+ * Description:
+ *   This is the common UHCI interrupt handler.  It passes completed Rx
+ *   descriptors to the receive buffer and, when an out link completes,
+ *   releases the sent data and starts the next transfer.
+ *
+ ****************************************************************************/
+
+static int esp32_dma_interrupt(struct uart_dev_s *dev)
+{
+  struct esp32_dev_s *priv;
+  struct esp32_dma_s *dma;
+  irqstate_t flags;
+  uint32_t status;
+  int16_t tail;
+
+  DEBUGASSERT(dev != NULL && dev->priv != NULL);
+  priv = (struct esp32_dev_s *)dev->priv;
+  dma  = priv->dma;
+
+#ifdef CONFIG_ESP32_UART_STATS
+  priv->stats.interrupts++;
+#endif
+
+  /* rxint() and txint() may run concurrently on the other CPU */
+
+  flags  = enter_critical_section();
+  status = esp32_dmain(dma, UHCI_INT_ST_OFFSET);
+  esp32_dmaout(dma, UHCI_INT_CLR_OFFSET, status);
+
+  if ((status & UART_DMA_RXINTS) != 0)
+    {
+      if ((status & UHCI_IN_DSCR_EMPTY_INT) != 0)
+        {
+          dma->rxstalled = true;
+        }
+
+      esp32_dma_rxdrain(dev);
+    }
+
+  if ((status & UHCI_OUT_TOTAL_EOF_INT) != 0 && dma->txlen > 0)
+    {
+      tail = dev->xmit.tail + dma->txlen;
+      if (tail >= dev->xmit.size)
+        {
+          tail -= dev->xmit.size;
+        }
+
+      dev->xmit.tail = tail;
+
+#ifdef CONFIG_ESP32_UART_STATS
+      priv->stats.txbytes += dma->txlen;
+#endif
+      dma->txlen     = 0;
+
+      uart_datasent(dev);
+      esp32_dma_txstart(dev);
+    }
+
+  leave_critical_section(flags);
+  return OK;
+}
+#endif
+
+/****************************************************************************
+ * Name: esp32_uart[n]_interrupt
+ *
+ * Description:
+ *   UART interrupt handlers
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_ESP32_UART0
+static int  esp32_uart0_interrupt(int cpuint, void *context)
+{
+  return esp32_interrupt(&g_uart0port);
+}
+#endif
+#ifdef CONFIG_ESP32_UART1
+static int  esp32_uart1_interrupt(int cpuint, void *context)
+{
+  return esp32_interrupt(&g_uart1port);
+}
+#endif
+#ifdef CONFIG_ESP32_UART2
+static int  esp32_uart2_interrupt(int cpuint, void *context)
+{
+  return esp32_interrupt(&g_uart2port);
+}
+#endif
+#ifdef CONFIG_ESP32_UART0_DMA
+static int  esp32_uart0_dma_interrupt(int cpuint, void *context)
+{
+  return esp32_dma_interrupt(&g_uart0port);
+}
+#endif
+#ifdef CONFIG_ESP32_UART1_DMA
+static int  esp32_uart1_dma_interrupt(int cpuint, void *context)
+{
+  return esp32_dma_interrupt(&g_uart1port);
+}
+#endif
+#ifdef CONFIG_ESP32_UART2_DMA
+static int  esp32_uart2_dma_interrupt(int cpuint, void *context)
+{
+  return esp32_dma_interrupt(&g_uart2port);
+}
+#endif
+
+#ifdef CONFIG_SERIAL_TERMIOS
+/****************************************************************************
+ * Name: esp32_txdrain
+ *
+ * Description:
+ *   Wait until everything queued for transmission, including the character
+ *   in the shift register, has been sent (TCSETSW and TCSETSF).
+ *
+ ****************************************************************************/
+
+static void esp32_txdrain(struct uart_dev_s *dev)
+{
+  struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+  useconds_t period;
+
+  /* Poll about every 16 character times while data is queued */
+
+  period = 160000000 / priv->baud + 1;
+  while (dev->xmit.head != dev->xmit.tail || !esp32_txempty(dev))
+    {
+      (void)usleep(period);
+    }
+
+  /* The FIFO is empty.  Wait for the transmitter to go idle;  this takes
+   * at most one character time.
+   */
+
+  while ((esp32_serialin(priv, UART_STATUS_OFFSET) &
+          UART_ST_UTX_OUT_M) != 0)
+    {
+    }
+}
+#endif /* CONFIG_SERIAL_TERMIOS */
+
+#ifdef CONFIG_SERIAL_TERMIOS
+/****************************************************************************
+ * Name: esp32_rxflush
+ *
+ * Description:
+ *   Discard all received data that has not yet been read (TCSETSF).
+ *
+ ****************************************************************************/
+
+static void esp32_rxflush(struct uart_dev_s *dev)
+{
+  struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+  irqstate_t flags;
+  uint32_t conf0;
+
+  flags = enter_critical_section();
+
+#ifdef CONFIG_ESP32_UART_DMA
+  if (priv->dma != NULL)
+    {
+      /* Recycle the descriptors already completed by the UHCI */
+
+      esp32_dma_rxdrain(dev);
+    }
+  else
+#endif
+    {
+      conf0 = esp32_serialin(priv, UART_CONF0_OFFSET);
+      esp32_serialout(priv, UART_CONF0_OFFSET, conf0 | UART_RXFIFO_RST);
+      esp32_serialout(priv, UART_CONF0_OFFSET, conf0);
+    }
+
+  dev->recv.tail = dev->recv.head;
+  leave_critical_section(flags);
+}
+#endif /* CONFIG_SERIAL_TERMIOS */
+
+/****************************************************************************
+ * Name: esp32_ioctl
+ *
+ * Description:
+ *   All ioctl calls will be routed through this method
+ *
+ ****************************************************************************/
+
+static int esp32_ioctl(struct file *filep, int cmd, unsigned long arg)
+{
+  struct inode      *inode = filep->f_inode;
+  struct uart_dev_s *dev   = inode->i_private;
+  int                ret    = OK;
+
+  switch (cmd)
+    {
+    case TIOCSFIFOCONF:
+      {
+        struct uart_fifoconf_s *conf = (struct uart_fifoconf_s *)arg;
+        struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+        irqstate_t flags;
+
+        if (!conf || conf->rxfull < 1 || conf->rxfull >= UART_FIFO_SIZE ||
+            conf->rxtout > UART_RX_TOUT_THRHD_V ||
+            conf->txempty < 1 || conf->txempty >= UART_FIFO_SIZE)
+          {
+            ret = -EINVAL;
+            break;
+          }
+
+#ifndef CONFIG_ESP32_UART_ADAPTIVE
+        if (conf->adaptive)
+          {
+            ret = -ENOSYS;
+            break;
+          }
+#endif
+
+        flags         = enter_critical_section();
+        priv->rxfull  = conf->rxfull;
+        priv->rxtout  = conf->rxtout;
+        priv->txempty = conf->txempty;
+#ifdef CONFIG_ESP32_UART_ADAPTIVE
+        priv->adaptive = conf->adaptive;
+        priv->rxbytes  = 0;
+        priv->rxstart  = clock_systimer();
+#endif
+        esp32_setfifoconf(priv, priv->rxfull, priv->rxtout);
+        leave_critical_section(flags);
+      }
+      break;
+
+    case TIOCGFIFOCONF:
+      {
+        struct uart_fifoconf_s *conf = (struct uart_fifoconf_s *)arg;
+        struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+
+        if (!conf)
+          {
+            ret = -EINVAL;
+            break;
+          }
+
+        conf->rxfull   = priv->rxfull;
+        conf->rxtout   = priv->rxtout;
+        conf->txempty  = priv->txempty;
+#ifdef CONFIG_ESP32_UART_ADAPTIVE
+        conf->adaptive = priv->adaptive;
+#else
+        conf->adaptive = false;
+#endif
+      }
+      break;
+
+#ifdef CONFIG_ESP32_UART_RS485
+    case TIOCSRS485:
+      {
+        struct serial_rs485 *rs485 = (struct serial_rs485 *)arg;
+        struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+        irqstate_t flags;
+
+        if (!rs485)
+          {
+            ret = -EINVAL;
+            break;
+          }
+
+        if (rs485->delay_rts_after_send > 0 && priv->rs485wd == NULL)
+          {
+            priv->rs485wd = wd_create();
+            if (priv->rs485wd == NULL)
+              {
+                ret = -ENOMEM;
+                break;
+              }
+          }
+
+        flags = enter_critical_section();
+        if ((priv->rs485.flags & SER_RS485_ENABLED) != 0 &&
+            (rs485->flags & SER_RS485_ENABLED) == 0)
+          {
+            esp32_configgpio(priv->config->depin, INPUT);
+            gpio_matrix_out(MATRIX_DETACH_OUT_SIG, priv->config->desig,
+                            true, false);
+          }
+
+        priv->rs485 = *rs485;
+        esp32_rs485_config(priv);
+        leave_critical_section(flags);
+      }
+      break;
+
+    case TIOCGRS485:
+      {
+        struct serial_rs485 *rs485 = (struct serial_rs485 *)arg;
+        struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+
+        if (!rs485)
+          {
+            ret = -EINVAL;
+            break;
+          }
+
+        *rs485 = priv->rs485;
+      }
+      break;
+#endif /* CONFIG_ESP32_UART_RS485 */
+
+#ifdef CONFIG_ESP32_UART_ZEROCOPY
+    case TIOCRXSPAN:
+      {
+        struct uart_span_s *span = (struct uart_span_s *)arg;
+        int16_t head = dev->recv.head;
+        int16_t tail = dev->recv.tail;
+
+        if (!span)
+          {
+            ret = -EINVAL;
+            break;
+          }
+
+        /* Received bytes from the tail up to the head or the buffer end */
+
+        span->buffer = &dev->recv.buffer[tail];
+        span->nbytes = (head >= tail) ? head - tail : dev->recv.size - tail;
+      }
+      break;
+
+    case TIOCRXRELEASE:
+      {
+        size_t nbytes = (size_t)arg;
+        irqstate_t flags;
+        int16_t head;
+        int16_t tail;
+
+        flags = enter_critical_section();
+        head  = dev->recv.head;
+        tail  = dev->recv.tail;
+
+        if (nbytes > (size_t)((head >= tail) ? head - tail :
+                              dev->recv.size - tail + head))
+          {
+            ret = -EINVAL;
+          }
+        else
+          {
+            tail += nbytes;
+            if (tail >= dev->recv.size)
+              {
+                tail -= dev->recv.size;
+              }
+
+            dev->recv.tail = tail;
+
+#ifdef CONFIG_ESP32_UART_DMA
+            /* Pass on any DMA buffers held back while recv was full */
+
+            if (((struct esp32_dev_s *)dev->priv)->dma != NULL)
+              {
+                esp32_dma_rxdrain(dev);
+              }
+#endif
+          }
+
+        leave_critical_section(flags);
+      }
+      break;
+
+    case TIOCTXRESERVE:
+      {
+        struct uart_span_s *span = (struct uart_span_s *)arg;
+        int16_t head = dev->xmit.head;
+        int16_t tail = dev->xmit.tail;
+
+        if (!span)
+          {
+            ret = -EINVAL;
+            break;
+          }
+
+        /* Free space from the head up to the tail or the buffer end.  One
+         * slot always stays empty to distinguish full from empty.
+         */
+
+        span->buffer = &dev->xmit.buffer[head];
+        span->nbytes = (tail > head) ? tail - head - 1 :
+                       dev->xmit.size - head - (tail == 0 ? 1 : 0);
+      }
+      break;
+
+    case TIOCTXCOMMIT:
+      {
+        size_t nbytes = (size_t)arg;
+        irqstate_t flags;
+        int16_t head;
+        int16_t tail;
+
+        flags = enter_critical_section();
+        head  = dev->xmit.head;
+        tail  = dev->xmit.tail;
+
+        if (nbytes > (size_t)((tail > head) ? tail - head - 1 :
+                              dev->xmit.size - head + tail - 1))
+          {
+            ret = -EINVAL;
+          }
+        else
+          {
+            head += nbytes;
+            if (head >= dev->xmit.size)
+              {
+                head -= dev->xmit.size;
+              }
+
+            dev->xmit.head = head;
+          }
+
+        leave_critical_section(flags);
+
+        /* Start (or continue) transmission as write() would */
+
+        if (ret == OK && nbytes > 0)
+          {
+            esp32_txint(dev, true);
+          }
+      }
+      break;
+#endif /* CONFIG_ESP32_UART_ZEROCOPY */
+
+#ifdef CONFIG_ESP32_UART_AUTOBAUD
+    case TIOCSAUTOBAUD:
+      {
+        struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+
+        if (arg != 0)
+          {
+            esp32_autobaud_start(priv);
+          }
+        else
+          {
+            esp32_autobaud_stop(priv);
+          }
+      }
+      break;
+
+    case TIOCGAUTOBAUD:
+      {
+        uint32_t *baud = (uint32_t *)arg;
+        struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+
+        if (!baud)
+          {
+            ret = -EINVAL;
+            break;
+          }
+
+        /* Poll too:  The line may have gone idle before the detection could
+         * be completed from the interrupt handler.
+         */
+
+        esp32_autobaud_poll(dev);
+        *baud = priv->autobaud ? 0 : priv->baud;
+      }
+      break;
+#endif /* CONFIG_ESP32_UART_AUTOBAUD */
 
-  /* Disable and detach the CPU interrupt */
+#ifdef CONFIG_ESP32_UART_PATTERN
+    case TIOCSPATTERN:
+      {
+        struct uart_pattern_s *pat = (struct uart_pattern_s *)arg;
+        struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+        uint32_t bittime;
+        irqstate_t flags;
 
-  up_disable_irq(priv->cpuint);
-  irq_detach(priv->config->irq);
+        if (!pat)
+          {
+            ret = -EINVAL;
+            break;
+          }
 
-  /* Disassociate the peripheral interrupt from the CPU interrupt */
+#ifdef CONFIG_ESP32_UART_DMA
+        /* The UHCI, not the interrupt handler, empties the RX FIFO */
 
-#ifdef CONFIG_SMP
-  cpu = up_cpu_index();
-#else
-  cpu = 0;
+        if (priv->dma != NULL)
+          {
+            ret = -ENOTSUP;
+            break;
+          }
 #endif
 
-  esp32_detach_peripheral(cpu, priv->config->periph);
+        /* The idle and gap counters run on the APB clock */
 
-  /* And release the CPU interrupt */
+        bittime = UART_CLK_FREQ / priv->baud;
 
-  esp32_free_cpuint(priv->cpuint);
-  priv->cpuint = 0xff;
-}
+        flags = enter_critical_section();
+        esp32_modifyint(priv, UART_AT_CMD_CHAR_DET_INT_ENA, 0);
 
-/****************************************************************************
- * Name: esp32_interrupt
- *
- * Description:
- *   This is the common UART interrupt handler.  It will be invoked
- *   when an interrupt received on the device.  It should call
- *   uart_transmitchars or uart_receivechar to perform the appropriate data
- *   transfers.
- *
- ****************************************************************************/
+        priv->pattern  = pat->count > 0;
+        priv->pathead  = 0;
+        priv->patcount = 0;
 
-static int esp32_interrupt(struct uart_dev_s *dev)
-{
-  struct esp32_dev_s *priv;
-  uint32_t regval;
-  uint32_t status;
-  int passes;
-  bool handled;
+        if (priv->pattern)
+          {
+            esp32_serialout(priv, UART_AT_CMD_CHAR_OFFSET,
+                            ((uint32_t)pat->chr << UART_AT_CMD_CHAR_S) |
+                            ((uint32_t)pat->count << UART_CHAR_NUM_S));
+            esp32_serialout(priv, UART_AT_CMD_GAPTOUT_OFFSET,
+                            (pat->gaptout * bittime) & UART_RX_GAP_TOUT_M);
+            esp32_serialout(priv, UART_AT_CMD_PRECNT_OFFSET,
+                            (pat->preidle * bittime) & UART_PRE_IDLE_NUM_M);
+            esp32_serialout(priv, UART_AT_CMD_POSTCNT_OFFSET,
+                            (pat->postidle * bittime) &
+                            UART_POST_IDLE_NUM_M);
+
+            esp32_serialout(priv, UART_INT_CLR_OFFSET,
+                            UART_AT_CMD_CHAR_DET_INT_CLR);
+            esp32_modifyint(priv, 0, UART_AT_CMD_CHAR_DET_INT_ENA);
+          }
 
-  DEBUGASSERT(dev != NULL && dev->priv != NULL);
-  priv = (struct esp32_dev_s *)dev->priv;
+        leave_critical_section(flags);
+      }
+      break;
 
-  /* Loop until there are no characters to be transferred or, until we have
-   * been looping for a long time.
-   */
+    case TIOCRXFRAME:
+      {
+        size_t *nbytes = (size_t *)arg;
+        struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+        uint32_t consumed;
+        int32_t len = 0;
+        irqstate_t flags;
 
-  handled = true;
-  for (passes = 0; passes < 256 && handled; passes++)
-    {
-      handled      = false;
-      priv->status = esp32_serialin(priv, UART_INT_RAW_OFFSET);
-      status       = esp32_serialin(priv, UART_STATUS_OFFSET);
+        if (!nbytes)
+          {
+            ret = -EINVAL;
+            break;
+          }
 
-      /* Clear pending interrupts */
+        /* The reader has consumed everything stored except what is still
+         * buffered.  Drop the delimiters it has already read past.
+         */
 
-      regval = (UART_RXFIFO_FULL_INT_CLR_S | UART_FRM_ERR_INT_CLR_S |
-                UART_RXFIFO_TOUT_INT_CLR_S | UART_TX_DONE_INT_CLR_S |
-                UART_TXFIFO_EMPTY_INT_CLR_S);
-      esp32_serialout(priv, UART_INT_CLR_OFFSET, regval);
+        flags = enter_critical_section();
 
-      if ((status & UART_RXFIFO_CNT_M) > 0)
-        {
-          /* Received data in the RXFIFO ... process incoming bytes */
+        consumed = priv->rxin -
+                   (dev->recv.head >= dev->recv.tail ?
+                    dev->recv.head - dev->recv.tail :
+                    dev->recv.size - dev->recv.tail + dev->recv.head);
 
-          uart_recvchars(dev);
-          handled = true;
-        }
+        while (priv->patcount > 0)
+          {
+            len = (int32_t)(priv->patpos[priv->pathead] - consumed);
+            if (len > 0)
+              {
+                break;
+              }
+
+            if (++priv->pathead >= CONFIG_ESP32_UART_PATTERN_QUEUE)
+              {
+                priv->pathead = 0;
+              }
+
+            priv->patcount--;
+          }
 
-      if ((status & UART_TXFIFO_CNT_M) < 0x7f)
-        {
-          /* The TXFIFO is not full ... process outgoing bytes */
+        *nbytes = priv->patcount > 0 ? (size_t)len : 0;
+        leave_critical_section(flags);
+      }
+      break;
+#endif /* CONFIG_ESP32_UART_PATTERN */
 
-          uart_xmitchars(dev);
-          handled = true;
-        }
-    }
+#ifdef CONFIG_ESP32_UART_STATS
+    case TIOCGSTATS:
+      {
+        struct uart_stats_s *stats = (struct uart_stats_s *)arg;
+        struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
 
-  return OK;
-}
+        if (!stats)
+          {
+            ret = -EINVAL;
+            break;
+          }
 
-/****************************************************************************
- * Name: esp32_uart[n]_interrupt
- *
- * Description:
- *   UART interrupt handlers
- *
- ****************************************************************************/
+        /* Each counter is read atomically;  the set need not be coherent */
 
-#ifdef CONFIG_ESP32_UART0
-static int  esp32_uart0_interrupt(int cpuint, void *context)
-{
-  return esp32_interrupt(&g_uart0port);
-}
-#endif
-#ifdef CONFIG_ESP32_UART1
-static int  esp32_uart1_interrupt(int cpuint, void *context)
-{
-  return esp32_interrupt(&g_uart1port);
-}
-#endif
-#ifdef CONFIG_ESP32_UART2
-static int  esp32_uart2_interrupt(int cpuint, void *context)
-{
-  return esp32_interrupt(&g_uart2port);
-}
-#endif
+        memcpy(stats, &priv->stats, sizeof(struct uart_stats_s));
+      }
+      break;
 
-/****************************************************************************
- * Name: esp32_ioctl
- *
- * Description:
- *   All ioctl calls will be routed through this method
- *
- ****************************************************************************/
+    case TIOCCSTATS:
+      {
+        struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+        irqstate_t flags;
 
-static int esp32_ioctl(struct file *filep, int cmd, unsigned long arg)
-{
-#if defined(CONFIG_SERIAL_TERMIOS) || defined(CONFIG_SERIAL_TIOCSERGSTRUCT)
-  struct inode      *inode = filep->f_inode;
-  struct uart_dev_s *dev   = inode->i_private;
-#endif
-  int                ret    = OK;
+        flags = enter_critical_section();
+        memset(&priv->stats, 0, sizeof(struct uart_stats_s));
+        leave_critical_section(flags);
+      }
+      break;
+#endif /* CONFIG_ESP32_UART_STATS */
 
-  switch (cmd)
-    {
 #ifdef CONFIG_SERIAL_TIOCSERGSTRUCT
     case TIOCSERGSTRUCT:
       {
@@ -889,6 +2974,8 @@ static int esp32_ioctl(struct file *filep, int cmd, unsigned long arg)
       break;
 
     case TCSETS:
+    case TCSETSW:
+    case TCSETSF:
       {
         struct termios  *termiosp = (struct termios *)arg;
         struct esp32_dev_s *priv    = (struct esp32_dev_s *)dev->priv;
@@ -911,6 +2998,10 @@ static int esp32_ioctl(struct file *filep, int cmd, unsigned long arg)
 
         ret = OK;
         baud = cfgetispeed(termiosp);
+        if (baud == 0)
+          {
+            ret = -EINVAL;
+          }
 
         /* Decode number of bits */
 
@@ -965,7 +3056,34 @@ static int esp32_ioctl(struct file *filep, int cmd, unsigned long arg)
 
         if (ret == OK)
           {
-            /* Commit */
+            /* TCSADRAIN and TCSAFLUSH:  Let pending output go out at the
+             * old settings first.  TCSAFLUSH also discards pending input.
+             */
+
+            if (cmd != TCSETS)
+              {
+                esp32_txdrain(dev);
+              }
+
+            if (cmd == TCSETSF)
+              {
+                esp32_rxflush(dev);
+              }
+
+            /* If only the rate changes, just rewrite the divider.  The
+             * port is not reset so no data is lost.
+             */
+
+            if (priv->parity == parity && priv->bits == nbits &&
+#if defined(CONFIG_SERIAL_IFLOWCONTROL) || defined(CONFIG_SERIAL_OFLOWCONTROL)
+                priv->flowc == flowc &&
+#endif
+                priv->stopbits2 == stop2)
+              {
+                priv->baud = baud;
+                esp32_setbaud(priv);
+                break;
+              }
 
             priv->baud      = baud;
             priv->parity    = parity;
@@ -974,9 +3092,7 @@ static int esp32_ioctl(struct file *filep, int cmd, unsigned long arg)
 #if defined(CONFIG_SERIAL_IFLOWCONTROL) || defined(CONFIG_SERIAL_OFLOWCONTROL)
             priv->flowc     = flowc;
 #endif
-            /* effect the changes immediately - note that we do not
-             * implement TCSADRAIN / TCSAFLUSH
-             */
+            /* Effect the other changes with a full reconfiguration */
 
             esp32_disableallints(priv, &intena);
             ret = esp32_setup(dev);
@@ -984,6 +3100,19 @@ static int esp32_ioctl(struct file *filep, int cmd, unsigned long arg)
             /* Restore the interrupt state */
 
             esp32_restoreuartint(priv, intena);
+
+#ifdef CONFIG_ESP32_UART_DMA
+            /* The reconfiguration stopped the out link and abandoned any
+             * transfer in flight.  Its data is still in the transmit
+             * buffer:  Start over from there (TCSETS may resend part of
+             * it) or nothing is sent until the next write.
+             */
+
+            if (priv->dma != NULL)
+              {
+                esp32_txint(dev, true);
+              }
+#endif
           }
       }
       break;
@@ -1032,28 +3161,54 @@ static int  esp32_receive(struct uart_dev_s *dev, unsigned int *status)
 static void esp32_rxint(struct uart_dev_s *dev, bool enable)
 {
   struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
-  int regval;
+
+#ifdef CONFIG_ESP32_UART_DMA
+  if (priv->dma != NULL)
+    {
+      irqstate_t flags = enter_critical_section();
+      uint32_t regval;
+
+      /* Mask or unmask the in link interrupts.  On enable, also pass on
+       * any descriptors held back while the receive buffer was full.
+       */
+
+      regval = esp32_dmain(priv->dma, UHCI_INT_ENA_OFFSET);
+      if (enable)
+        {
+          esp32_dmaout(priv->dma, UHCI_INT_ENA_OFFSET,
+                       regval | UART_DMA_RXINTS);
+          esp32_dma_rxdrain(dev);
+        }
+      else
+        {
+          esp32_dmaout(priv->dma, UHCI_INT_ENA_OFFSET,
+                       regval & ~UART_DMA_RXINTS);
+        }
+
+      leave_critical_section(flags);
+      return;
+    }
+#endif
 
   if (enable)
     {
-      /* Receive an interrupt when their is anything in the Rx data register (or an Rx
-       * timeout occurs).
+      /* Receive an interrupt when the RX FIFO reaches its threshold (or an
+       * Rx timeout occurs).
        */
 
 #ifndef CONFIG_SUPPRESS_SERIAL_INTS
-      regval  = esp32_serialin(priv, UART_INT_ENA_OFFSET);
-      regval |= (UART_RXFIFO_FULL_INT_CLR_S | UART_FRM_ERR_INT_CLR_S |
-                 UART_RXFIFO_TOUT_INT_CLR_S);
-      esp32_serialout(priv, UART_INT_ENA_OFFSET, regval);
+      esp32_modifyint(priv, 0, UART_RXFIFO_FULL_INT_ENA |
+                      UART_ERR_INT_ENA | UART_RXFIFO_TOUT_INT_ENA |
+                      UART_RXFIFO_OVF_INT_ENA);
 #endif
     }
   else
     {
       /* Disable the RX interrupts */
 
-      esp32_serialout(priv, UART_INT_CLR_OFFSET,
-                      (UART_RXFIFO_FULL_INT_CLR_S | UART_FRM_ERR_INT_CLR_S |
-                       UART_RXFIFO_TOUT_INT_CLR_S));
+      esp32_modifyint(priv, UART_RXFIFO_FULL_INT_ENA |
+                      UART_ERR_INT_ENA | UART_RXFIFO_TOUT_INT_ENA |
+                      UART_RXFIFO_OVF_INT_ENA, 0);
     }
 }
 
@@ -1069,6 +3224,14 @@ static bool esp32_rxavailable(struct uart_dev_s *dev)
 {
   struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
 
+#ifdef CONFIG_ESP32_UART_DMA
+  if (priv->dma != NULL)
+    {
+      return (priv->dma->rxdesc[priv->dma->rxnext].ctrl &
+              DMA_DESC_OWNER) == 0;
+    }
+#endif
+
   return ((esp32_serialin(priv, UART_STATUS_OFFSET) & UART_RXFIFO_CNT_M) > 0);
 }
 
@@ -1087,6 +3250,50 @@ static void esp32_send(struct uart_dev_s *dev, int ch)
   esp32_serialout(priv, UART_FIFO_OFFSET, (uint32_t)ch);
 }
 
+#ifdef CONFIG_ESP32_UART_LOCKFREE
+/****************************************************************************
+ * Name: esp32_txint_lockfree
+ *
+ * Description:
+ *   esp32_txint() for FIFO mode without the global critical section.  The
+ *   interrupt handler is the only reader of the TX buffer, so this only
+ *   enables the TX FIFO empty interrupt:  It is raised at once if the FIFO
+ *   is below its threshold.
+ *
+ ****************************************************************************/
+
+static void esp32_txint_lockfree(struct uart_dev_s *dev, bool enable)
+{
+  struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
+
+  if (enable)
+    {
+#ifndef CONFIG_SUPPRESS_SERIAL_INTS
+#ifdef CONFIG_ESP32_UART_RS485
+      if ((priv->rs485.flags & SER_RS485_ENABLED) != 0 &&
+          dev->xmit.head != dev->xmit.tail)
+        {
+          irqstate_t flags = enter_critical_section();
+          bool delay = esp32_rs485_txon(priv);
+          leave_critical_section(flags);
+
+          if (delay)
+            {
+              up_mdelay(priv->rs485.delay_rts_before_send);
+            }
+        }
+#endif
+
+      esp32_modifyint(priv, 0, UART_TXFIFO_EMPTY_INT_ENA);
+#endif
+    }
+  else
+    {
+      esp32_modifyint(priv, UART_TXFIFO_EMPTY_INT_ENA, 0);
+    }
+}
+#endif
+
 /****************************************************************************
  * Name: esp32_txint
  *
@@ -1100,34 +3307,85 @@ static void esp32_txint(struct uart_dev_s *dev, bool enable)
   struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
   irqstate_t flags;
 
+#ifdef CONFIG_ESP32_UART_LOCKFREE
+#ifdef CONFIG_ESP32_UART_DMA
+  if (priv->dma == NULL)
+#endif
+    {
+      esp32_txint_lockfree(dev, enable);
+      return;
+    }
+#endif
+
   flags = enter_critical_section();
 
+#ifdef CONFIG_ESP32_UART_DMA
+  if (priv->dma != NULL)
+    {
+      /* Start the out link if it is idle.  There is nothing to disable:
+       * A transfer in flight always runs to completion.
+       */
+
+      if (enable && dev->xmit.head != dev->xmit.tail)
+        {
+#ifdef CONFIG_ESP32_UART_RS485
+          if (esp32_rs485_txon(priv))
+            {
+              /* Wait for the delay before send outside of the critical
+               * section.
+               */
+
+              leave_critical_section(flags);
+              up_mdelay(priv->rs485.delay_rts_before_send);
+              flags = enter_critical_section();
+            }
+#endif
+          esp32_dma_txstart(dev);
+        }
+
+      leave_critical_section(flags);
+      return;
+    }
+#endif
+
   if (enable)
     {
-      uint32_t regval;
+      uint32_t status;
 
-      /* Set to receive an interrupt when the TX holding register register
-       * is empty
+      /* Set to receive an interrupt when the TX FIFO drops below its
+       * threshold.
        */
 
 #ifndef CONFIG_SUPPRESS_SERIAL_INTS
-      regval  = esp32_serialin(priv, UART_INT_ENA_OFFSET);
-      regval |= (UART_TX_DONE_INT_ENA_S | UART_TXFIFO_EMPTY_INT_ENA_S);
-      esp32_serialout(priv, UART_INT_ENA_OFFSET, regval);
+#ifdef CONFIG_ESP32_UART_RS485
+      if (dev->xmit.head != dev->xmit.tail && esp32_rs485_txon(priv))
+        {
+          /* Wait for the delay before send outside of the critical
+           * section.
+           */
+
+          leave_critical_section(flags);
+          up_mdelay(priv->rs485.delay_rts_before_send);
+          flags = enter_critical_section();
+        }
+#endif
+
+      esp32_modifyint(priv, 0, UART_TXFIFO_EMPTY_INT_ENA);
 
-      /* Fake a TX interrupt here by just calling uart_xmitchars() with
-       * interrupts disabled (note this may recurse).
+      /* Fake a TX interrupt here by filling the TX FIFO now with
+       * interrupts disabled.
        */
 
-      uart_xmitchars(dev);
+      status = esp32_serialin(priv, UART_STATUS_OFFSET);
+      (void)esp32_txburst(dev, UART_FIFO_SIZE -
+                          ((status & UART_TXFIFO_CNT_M) >> UART_TXFIFO_CNT_S));
 #endif
     }
   else
     {
       /* Disable the TX interrupt */
 
-      esp32_serialout(priv, UART_INT_CLR_OFFSET,
-                      (UART_TX_DONE_INT_CLR_S | UART_TXFIFO_EMPTY_INT_CLR_S));
+      esp32_modifyint(priv, UART_TXFIFO_EMPTY_INT_ENA, 0);
     }
 
   leave_critical_section(flags);
@@ -1145,7 +3403,9 @@ static bool esp32_txready(struct uart_dev_s *dev)
 {
   struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
 
-  return ((esp32_serialin(priv, UART_STATUS_OFFSET) & UART_TXFIFO_CNT_M) < 0x7f);
+  uint32_t status = esp32_serialin(priv, UART_STATUS_OFFSET);
+
+  return ((status & UART_TXFIFO_CNT_M) >> UART_TXFIFO_CNT_S) < UART_FIFO_SIZE;
 }
 
 /****************************************************************************
@@ -1160,8 +3420,166 @@ static bool esp32_txempty(struct uart_dev_s *dev)
 {
   struct esp32_dev_s *priv = (struct esp32_dev_s *)dev->priv;
 
-  return ((esp32_serialin(priv, UART_STATUS_OFFSET) & UART_TXFIFO_CNT_M) > 0);
+#ifdef CONFIG_ESP32_UART_DMA
+  if (priv->dma != NULL && priv->dma->txlen > 0)
+    {
+      return false;
+    }
+#endif
+
+  return ((esp32_serialin(priv, UART_STATUS_OFFSET) & UART_TXFIFO_CNT_M) == 0);
+}
+
+#ifdef HAVE_UART_PROCFS
+/****************************************************************************
+ * Name: esp32_procfs_open
+ ****************************************************************************/
+
+static int esp32_procfs_open(struct file *filep, const char *relpath,
+                             int oflags, mode_t mode)
+{
+  struct esp32_procfs_file_s *procfile;
+
+  /* The file is read-only */
+
+  if ((oflags & O_WRONLY) != 0 || (oflags & O_RDONLY) == 0)
+    {
+      return -EACCES;
+    }
+
+  procfile = (struct esp32_procfs_file_s *)
+    kmm_zalloc(sizeof(struct esp32_procfs_file_s));
+  if (procfile == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  filep->f_priv = (void *)procfile;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: esp32_procfs_close
+ ****************************************************************************/
+
+static int esp32_procfs_close(struct file *filep)
+{
+  DEBUGASSERT(filep->f_priv != NULL);
+
+  kmm_free(filep->f_priv);
+  filep->f_priv = NULL;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: esp32_procfs_read
+ *
+ * Description:
+ *   Format one line of counters per serial port.
+ *
+ ****************************************************************************/
+
+static ssize_t esp32_procfs_read(struct file *filep, char *buffer,
+                                 size_t buflen)
+{
+  struct esp32_procfs_file_s *procfile;
+  struct esp32_dev_s *priv;
+  struct uart_stats_s stats;
+  off_t offset = filep->f_pos;
+  size_t totalsize = 0;
+  size_t linesize;
+  size_t copysize;
+  uint32_t average;
+  int i;
+
+  procfile = (struct esp32_procfs_file_s *)filep->f_priv;
+  DEBUGASSERT(procfile != NULL);
+
+  linesize = snprintf(procfile->line, UART_PROCFS_LINELEN,
+                      "%-6s %10s %10s %8s %8s %5s %6s %6s %6s %8s\n",
+                      "PORT", "RXBYTES", "TXBYTES", "INTS", "PASSES",
+                      "B/INT", "RXOVF", "FRAME", "PARITY", "DROPPED");
+
+  if (linesize >= UART_PROCFS_LINELEN)
+    {
+      linesize = UART_PROCFS_LINELEN - 1;
+    }
+
+  copysize = procfs_memcpy(procfile->line, linesize, buffer, buflen,
+                           &offset);
+  totalsize += copysize;
+
+  for (i = 0; i < UART_PROCFS_NPORTS && totalsize < buflen; i++)
+    {
+      priv  = (struct esp32_dev_s *)g_uart_procfs_ports[i]->priv;
+      memcpy(&stats, &priv->stats, sizeof(struct uart_stats_s));
+
+      average = stats.interrupts > 0 ?
+                (stats.rxbytes + stats.txbytes) / stats.interrupts : 0;
+
+      linesize = snprintf(procfile->line, UART_PROCFS_LINELEN,
+                          "ttyS%-2d %10lu %10lu %8lu %8lu %5lu %6lu %6lu "
+                          "%6lu %8lu\n", i,
+                          (unsigned long)stats.rxbytes,
+                          (unsigned long)stats.txbytes,
+                          (unsigned long)stats.interrupts,
+                          (unsigned long)stats.passes,
+                          (unsigned long)average,
+                          (unsigned long)stats.rxoverflow,
+                          (unsigned long)stats.frameerr,
+                          (unsigned long)stats.parityerr,
+                          (unsigned long)stats.rxdropped);
+
+      if (linesize >= UART_PROCFS_LINELEN)
+        {
+          linesize = UART_PROCFS_LINELEN - 1;
+        }
+
+      copysize = procfs_memcpy(procfile->line, linesize,
+                               &buffer[totalsize], buflen - totalsize,
+                               &offset);
+      totalsize += copysize;
+    }
+
+  filep->f_pos += totalsize;
+  return totalsize;
+}
+
+/****************************************************************************
+ * Name: esp32_procfs_dup
+ ****************************************************************************/
+
+static int esp32_procfs_dup(const struct file *oldp, struct file *newp)
+{
+  struct esp32_procfs_file_s *oldfile;
+  struct esp32_procfs_file_s *newfile;
+
+  oldfile = (struct esp32_procfs_file_s *)oldp->f_priv;
+  DEBUGASSERT(oldfile != NULL);
+
+  newfile = (struct esp32_procfs_file_s *)
+    kmm_malloc(sizeof(struct esp32_procfs_file_s));
+  if (newfile == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  memcpy(newfile, oldfile, sizeof(struct esp32_procfs_file_s));
+  newp->f_priv = (void *)newfile;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: esp32_procfs_stat
+ ****************************************************************************/
+
+static int esp32_procfs_stat(const char *relpath, struct stat *buf)
+{
+  memset(buf, 0, sizeof(struct stat));
+  buf->st_mode = S_IFREG | S_IROTH | S_IRGRP | S_IRUSR;
+  return OK;
 }
+#endif /* HAVE_UART_PROCFS */
 
 /****************************************************************************
  * Public Functions
@@ -1229,6 +3647,12 @@ void xtensa_serial_initialize(void)
 #ifdef TTYS2_DEV
   (void)uart_register("/dev/ttyS2", &TTYS2_DEV);
 #endif
+
+#ifdef HAVE_UART_PROCFS
+  /* Register /proc/uart */
+
+  (void)procfs_register(&g_uart_procfs_entry);
+#endif
 }
 
 /****************************************************************************
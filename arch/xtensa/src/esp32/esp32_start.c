@@ -85,6 +85,10 @@ void IRAM_ATTR __start(void)
 
   memset(&_sbss, 0, (&_ebss - &_sbss) * sizeof(_sbss));
 
+  /* Locate the per-CPU data of CPU0 */
+
+  xtensa_percpu_initialize(0);
+
   /* Make sure that the APP_CPU is disabled for now */
 
   regval  = getreg32(DPORT_APPCPU_CTRL_B_REG);
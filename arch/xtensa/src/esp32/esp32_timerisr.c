@@ -50,6 +50,7 @@
 #include "clock/clock.h"
 #include "xtensa_timer.h"
 #include "xtensa.h"
+#include "esp32_cpuint.h"
 
 /****************************************************************************
  * Private data
@@ -57,6 +58,12 @@
 
 static uint32_t g_tick_divisor;
 
+#ifdef CONFIG_ESP32_IRQ_BALANCE
+/* Ticks remaining until the next peripheral interrupt rebalance */
+
+static uint32_t g_balance_ticks = CONFIG_ESP32_IRQ_BALANCE_INTERVAL;
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -144,6 +151,16 @@ static int esp32_timerisr(int irq, uint32_t *regs)
 
       sched_process_timer();
 
+#ifdef CONFIG_ESP32_IRQ_BALANCE
+      /* Periodically even out the peripheral interrupt load of the CPUs */
+
+      if (--g_balance_ticks == 0)
+        {
+          g_balance_ticks = CONFIG_ESP32_IRQ_BALANCE_INTERVAL;
+          esp32_irq_rebalance();
+        }
+#endif
+
       /* Check if we are falling behind and need to process multiple timer
        * interrupts.
        */